@@ -0,0 +1,465 @@
+/*
+ * NMEA Decoder - Batch Decoding of Capture Files (host build only)
+ *
+ * The capture is cut into NMEA_BATCH_CHUNK sized chunks. A chunk owns
+ * every sentence whose '$' lies inside it, and its worker reads on past
+ * the end of the chunk to finish the last one, so a cut never loses or
+ * repeats a sentence. Chunks are handed out a round of one per thread at
+ * a time; once a round is done its results are reported in chunk order
+ * and freed, which keeps the output in capture order and the memory
+ * used down to a round's worth.
+ *
+ * Capture files are memory mapped rather than read, so the framer and
+ * decoders run straight over the page cache with no copies at all. The
+ * file is mapped a window at a time, each window overlapping the next by
+ * the length of a sentence, so files bigger than memory (or than the
+ * address space on a 32 bit host) stream through a window's worth of
+ * mapping.
+ *
+ * e.g. gcc -O2 -DNMEA_HOST -DNMEA_PACKED_RING -DNMEA_BATCH_MAIN
+ *          nmea_batch.c nmea_dec.c -lpthread -o nmeabatch
+ *      ./nmeabatch capture.nmea [threads]
+ */
+
+/*
+ *  Include Files
+ */
+#include "nmea_host.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ascii_16.h"
+#include "nmea_dec.h"
+#include "nmea_batch.h"
+
+#ifndef NMEA_PACKED_RING
+#error "nmea_batch.c decodes byte captures, build with NMEA_PACKED_RING"
+#endif
+
+/*
+ *  Declarations
+ */
+#ifndef NMEA_BATCH_CHUNK
+#define NMEA_BATCH_CHUNK	(4UL << 20)		// Bytes of capture per chunk
+#endif
+#define NMEA_BATCH_READ		(NMEA_MAXLENGTH + 4)
+											// Furthest a chunk's last sentence can run on
+											// ('$', text, '*' and checksum)
+#ifndef NMEA_MAP_WINDOW
+#define NMEA_MAP_WINDOW		(256UL << 20)	// Bytes of file mapped at once, a multiple
+#endif										// of the page size
+
+typedef struct {
+	const nmeaChar * data;					// Start of the chunk in the capture
+	size_t offset;							// Where that is in the capture
+	Uint32 length;							// Chunk size
+	Uint32 readable;						// How far on we may read to finish a sentence
+	nmeaBatchResult * results;				// What was decoded, in order
+	size_t resultCount;
+	size_t resultSize;						// Entries allocated
+	int failed;								// Ran out of memory
+} nmeaBatchChunk;
+
+typedef struct {
+	nmeaContext * context;					// Worker's own decoder state
+	nmeaBatchChunk * chunk;					// What it has been given this round
+	pthread_t thread;
+} nmeaBatchWorker;
+
+/*
+ *  Prototypes
+ */
+long nmeaBatchWindow(const nmeaChar * data, size_t owned, size_t count, size_t base,
+					 unsigned threads, nmeaBatchCallback callback, void * arg);
+											// Decodes the sentences starting in the first
+											// owned bytes of data
+void * nmeaBatchWork(void * arg);			// Decodes one chunk
+int nmeaBatchAdd(nmeaBatchChunk * chunk, const nmeaBatchResult * result);
+											// Appends to a chunk's results
+
+
+long nmeaBatchDecode(const nmeaChar * data, size_t count, unsigned threads,
+					 nmeaBatchCallback callback, void * arg)
+{
+	return nmeaBatchWindow(data, count, count, 0, threads, callback, arg);
+}
+
+long nmeaBatchMapFile(const char * path, unsigned threads,
+					  nmeaBatchCallback callback, void * arg)
+{
+	struct stat info;
+	nmeaChar * map;
+	size_t size;							// Whole file
+	size_t base;							// Where the current window starts in the file
+	size_t owned;							// Bytes whose sentences the window decodes
+	size_t mapped;							// ... plus the overlap into the next window
+	long reported;
+	long result;
+	int file;
+
+	file = open(path, O_RDONLY);
+	if (file < 0)
+	{
+		return -1;
+	}
+	if (fstat(file, &info) != 0)
+	{
+		close(file);
+		return -1;
+	}
+
+	size = (size_t)info.st_size;
+	reported = 0;
+
+	for (base = 0; base < size; base += owned)
+	{
+		owned = (size - base < NMEA_MAP_WINDOW) ? size - base : NMEA_MAP_WINDOW;
+		mapped = (size - base < NMEA_MAP_WINDOW + NMEA_BATCH_READ) ? size - base
+																   : NMEA_MAP_WINDOW + NMEA_BATCH_READ;
+
+		map = mmap(NULL, mapped, PROT_READ, MAP_PRIVATE, file, (off_t)base);
+		if (map == MAP_FAILED)
+		{
+			reported = -1;
+			break;
+		}
+		madvise(map, mapped, MADV_SEQUENTIAL);
+
+		result = nmeaBatchWindow(map, owned, mapped, base, threads, callback, arg);
+		munmap(map, mapped);
+
+		if (result < 0)
+		{
+			reported = -1;
+			break;
+		}
+		reported += result;
+	}
+
+	close(file);
+	return reported;
+}
+
+/*----------------------------------------------------------------------------
+ Decode part of a capture
+
+ Decodes the sentences whose '$' is in the first owned bytes of data,
+ reading on up to count bytes to finish the last. Offsets are reported
+ from base, where data sits in the whole capture.
+----------------------------------------------------------------------------*/
+long nmeaBatchWindow(const nmeaChar * data, size_t owned, size_t count, size_t base,
+					 unsigned threads, nmeaBatchCallback callback, void * arg)
+{
+	nmeaBatchWorker * workers;
+	nmeaBatchChunk * chunks;
+	size_t next;							// Start of the next chunk to hand out
+	size_t i;
+	unsigned t;
+	unsigned running;						// Workers busy this round
+	long reported;
+	int failed;
+
+	if (threads == 0)
+	{
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (cores > 0) ? (unsigned)cores : 1;
+	}
+
+	// No point having threads without chunks for them
+	if (threads > owned / NMEA_BATCH_CHUNK + 1)
+	{
+		threads = (unsigned)(owned / NMEA_BATCH_CHUNK + 1);
+	}
+
+	workers = calloc(threads, sizeof(nmeaBatchWorker));
+	chunks = calloc(threads, sizeof(nmeaBatchChunk));
+	failed = (workers == NULL || chunks == NULL);
+
+	for (t = 0; !failed && t < threads; t++)
+	{
+		if (posix_memalign((void **)&workers[t].context, 64, sizeof(nmeaContext)) != 0)
+		{
+			workers[t].context = NULL;
+			failed = 1;
+			break;
+		}
+		// Gets the decoders registered before any thread looks them up,
+		// nmeaBatchWork() sets the context up afresh for each chunk
+		nmeaInitContext(workers[t].context);
+		workers[t].chunk = &chunks[t];
+	}
+
+	next = 0;
+	reported = 0;
+
+	while (!failed && next < owned)
+	{
+		// Hand out this round's chunks
+		for (running = 0; running < threads && next < owned; running++)
+		{
+			nmeaBatchChunk * chunk = &chunks[running];
+			size_t left = owned - next;
+			size_t readable = count - next;
+
+			chunk->data = data + next;
+			chunk->offset = base + next;
+			chunk->length = (left < NMEA_BATCH_CHUNK) ? (Uint32)left : NMEA_BATCH_CHUNK;
+			chunk->readable = (readable < NMEA_BATCH_CHUNK + NMEA_BATCH_READ) ? (Uint32)readable
+																			  : NMEA_BATCH_CHUNK + NMEA_BATCH_READ;
+			chunk->resultCount = 0;
+			chunk->failed = 0;
+			next += chunk->length;
+
+			// The last chunk of a round is decoded on this thread
+			if (running + 1 < threads && next < owned)
+			{
+				if (pthread_create(&workers[running].thread, NULL, nmeaBatchWork, &workers[running]) != 0)
+				{
+					failed = 1;
+					break;
+				}
+			}
+			else
+			{
+				nmeaBatchWork(&workers[running]);
+			}
+		}
+
+		// Wait for the round, then report it in order. Only the last chunk
+		// ran here; any chunk before it that started has a thread to join
+		for (t = 0; t < running; t++)
+		{
+			if (t + 1 < running || failed)
+			{
+				pthread_join(workers[t].thread, NULL);
+			}
+			failed |= chunks[t].failed;
+		}
+
+		for (t = 0; !failed && t < running; t++)
+		{
+			for (i = 0; i < chunks[t].resultCount; i++)
+			{
+				callback(&chunks[t].results[i], arg);
+				reported++;
+			}
+		}
+	}
+
+	for (t = 0; chunks != NULL && t < threads; t++)
+	{
+		free(chunks[t].results);
+	}
+	for (t = 0; workers != NULL && t < threads; t++)
+	{
+		free(workers[t].context);
+	}
+	free(chunks);
+	free(workers);
+
+	return failed ? -1 : reported;
+}
+
+/*----------------------------------------------------------------------------
+ Worker for one chunk
+
+ Frames and decodes every sentence whose '$' is in the chunk. Uses the
+ same framer rules and decoders as the UART path, just without the ring.
+----------------------------------------------------------------------------*/
+void * nmeaBatchWork(void * arg)
+{
+	nmeaBatchWorker * worker = arg;
+	nmeaBatchChunk * chunk = worker->chunk;
+	nmeaContext * context = worker->context;
+	nmeaSentenceView view;
+	nmeaBatchResult result;
+	Uint32 position;
+	Uint32 dollar;
+
+	// Nothing carries over from the last chunk this worker decoded, not
+	// even a GSV cycle or epoch part way through, or the sentence count
+	// that times them out
+	nmeaInitContext(context);
+	// Results are per sentence, there is no use for whole epochs
+	context->pollMask &= ~NMEA_EVENT_EPOCH;
+
+	position = 0;
+
+	while (nmeaFrameText(chunk->data, chunk->readable, &position, &view))
+	{
+		// Anything starting past the end belongs to the next chunk
+		dollar = (Uint32)(view.text - chunk->data) - 1;
+		if (dollar >= chunk->length)
+		{
+			break;
+		}
+
+		result.events = nmeaDecodeSentence(context, &view);
+		if (result.events == 0)
+		{
+			continue;
+		}
+
+		result.offset = chunk->offset + dollar;
+		result.address = nmeaSentenceAddress(&view);
+
+		if (result.events & NMEA_EVENT_POSITION)
+		{
+			result.data.position = context->geographicPos;
+		}
+		else if (result.events & NMEA_EVENT_SATELLITES)
+		{
+			result.data.sky.constellation = nmeaAddressConstellation(result.address);
+			result.data.sky.satellitesInView = context->sky.satellitesInView[result.data.sky.constellation];
+			result.data.sky.count = context->sky.count;
+		}
+		else if (result.events & NMEA_EVENT_FIX)
+		{
+			result.data.fix = context->fixData;
+		}
+		else if (result.events & NMEA_EVENT_NAVIGATION)
+		{
+			result.data.navigation = context->navigationData;
+		}
+		else if (result.events & NMEA_EVENT_ACTIVE)
+		{
+			result.data.active = context->activeSats;
+		}
+		else if (result.events & NMEA_EVENT_VELOCITY)
+		{
+			result.data.velocity = context->velocity;
+		}
+		else if (result.events & NMEA_EVENT_TIME)
+		{
+			result.data.dateTime = context->dateTime;
+		}
+
+		if (!nmeaBatchAdd(chunk, &result))
+		{
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+int nmeaBatchAdd(nmeaBatchChunk * chunk, const nmeaBatchResult * result)
+{
+	nmeaBatchResult * results;
+
+	if (chunk->resultCount == chunk->resultSize)
+	{
+		size_t size = chunk->resultSize ? chunk->resultSize * 2 : 1024;
+
+		results = realloc(chunk->results, size * sizeof(nmeaBatchResult));
+		if (results == NULL)
+		{
+			chunk->failed = 1;
+			return 0;
+		}
+		chunk->results = results;
+		chunk->resultSize = size;
+	}
+
+	chunk->results[chunk->resultCount++] = *result;
+	return 1;
+}
+
+
+
+#ifdef NMEA_BATCH_MAIN
+/*----------------------------------------------------------------------------
+ Command line front end
+
+ Reads a capture and prints one line per decoded sentence:
+	offset,POS,status,hh:mm:ss,latitudeE7,longitudeE7
+	offset,SATS,constellation,inView,inTable
+	offset,FIX,quality,used,hdop,altitude,separation
+	offset,NAV,status,epoch,speed,course,variation
+	offset,DOP,mode,used,pdop,hdop,vdop
+	offset,VEL,course,magnetic,knots,kph
+	offset,ZDA,epoch,zoneHours,zoneMinutes
+----------------------------------------------------------------------------*/
+void nmeaBatchPrint(const nmeaBatchResult * result, void * arg)
+{
+	FILE * out = arg;
+	const nmeaGeographicPosition * pos = &result->data.position;
+
+	if (result->events & NMEA_EVENT_POSITION)
+	{
+		fprintf(out, "%zu,POS,%c,%02d:%02d:%02d,%ld,%ld\n", result->offset,
+				pos->status ? pos->status : '-',
+				pos->utcGpsTime.utcHours, pos->utcGpsTime.utcMinutes, pos->utcGpsTime.utcSeconds,
+				(long)pos->latitudeE7, (long)pos->longitudeE7);
+	}
+	else if (result->events & NMEA_EVENT_SATELLITES)
+	{
+		const nmeaBatchSky * sky = &result->data.sky;
+
+		fprintf(out, "%zu,SATS,%d,%d,%d\n", result->offset, sky->constellation,
+				sky->satellitesInView, sky->count);
+	}
+	else if (result->events & NMEA_EVENT_FIX)
+	{
+		const nmeaFixData * fix = &result->data.fix;
+
+		fprintf(out, "%zu,FIX,%d,%d,%d.%02d,%ld,%ld\n", result->offset, fix->fixQuality,
+				fix->satellitesUsed, fix->hdop / 100, fix->hdop % 100,
+				(long)fix->altitude, (long)fix->geoidSeparation);
+	}
+	else if (result->events & NMEA_EVENT_NAVIGATION)
+	{
+		const nmeaNavigationData * nav = &result->data.navigation;
+
+		fprintf(out, "%zu,NAV,%c,%lu,%d,%d,%d\n", result->offset, nav->status,
+				(unsigned long)nav->utcEpoch, nav->speed, nav->course, nav->magneticVariation);
+	}
+	else if (result->events & NMEA_EVENT_ACTIVE)
+	{
+		const nmeaActiveSatellites * active = &result->data.active;
+
+		fprintf(out, "%zu,DOP,%d,%d,%d,%d,%d\n", result->offset, active->fixMode,
+				active->usedCount, active->pdop, active->hdop, active->vdop);
+	}
+	else if (result->events & NMEA_EVENT_VELOCITY)
+	{
+		const nmeaVelocityData * velocity = &result->data.velocity;
+
+		fprintf(out, "%zu,VEL,%d,%d,%d,%d\n", result->offset, velocity->course,
+				velocity->courseMagnetic, velocity->speedKnots, velocity->speedKph);
+	}
+	else if (result->events & NMEA_EVENT_TIME)
+	{
+		const nmeaDateTime * dateTime = &result->data.dateTime;
+
+		fprintf(out, "%zu,ZDA,%lu,%d,%d\n", result->offset, (unsigned long)dateTime->utcEpoch,
+				dateTime->zoneHours, dateTime->zoneMinutes);
+	}
+}
+
+int main(int argc, char * argv[])
+{
+	long reported;
+	unsigned threads;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s capture [threads]\n", argv[0]);
+		return 2;
+	}
+
+	threads = (argc > 2) ? (unsigned)atoi(argv[2]) : 0;
+
+	reported = nmeaBatchMapFile(argv[1], threads, nmeaBatchPrint, stdout);
+	if (reported < 0)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	return 0;
+}
+#endif
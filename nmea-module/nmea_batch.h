@@ -0,0 +1,63 @@
+/*
+ * NMEA Decoder - Batch Decoding of Capture Files (host build only)
+ *
+ * Decodes a whole NMEA capture that is already in memory, splitting it
+ * into chunks that are decoded on all the cores at once. Needs nmea_dec.c
+ * built with NMEA_HOST and NMEA_PACKED_RING (captures are bytes).
+ */
+
+/*----------------------------------------------------------------------------
+ One decoded sentence
+
+ A copy of what the sentence's decoder updated, tagged with where the
+ sentence starts in the capture. Only sentences a decoder did something
+ with are reported; bad checksums and sentences nobody decodes are not.
+
+ Each chunk is decoded with a fresh context, so data a decoder builds up
+ over several sentences (the sky table from GSV) only covers the
+ sentences since the start of its chunk. A GSV cycle is only summed up,
+ as a whole sky table would make every result several hundred bytes.
+----------------------------------------------------------------------------*/
+typedef struct {
+	Uint16 constellation;					// Talker of the GSV cycle (NMEA_CONSTELLATION_xxx)
+	Uint16 satellitesInView;				// What the cycle said it had in view
+	Uint16 count;							// Satellites in the sky table after it
+} nmeaBatchSky;
+
+typedef struct {
+	size_t offset;							// Where the sentence's '$' is in the capture
+	Uint32 address;							// NMEA_ADDRESS() of the sentence
+	Uint16 events;							// What its decoder updated (NMEA_EVENT_xxx)
+	union {
+		nmeaGeographicPosition position;	// NMEA_EVENT_POSITION
+		nmeaBatchSky sky;					// NMEA_EVENT_SATELLITES
+		nmeaFixData fix;					// NMEA_EVENT_FIX
+		nmeaNavigationData navigation;		// NMEA_EVENT_NAVIGATION
+		nmeaActiveSatellites active;		// NMEA_EVENT_ACTIVE
+		nmeaVelocityData velocity;			// NMEA_EVENT_VELOCITY
+		nmeaDateTime dateTime;				// NMEA_EVENT_TIME
+	} data;
+} nmeaBatchResult;
+
+typedef void (*nmeaBatchCallback)(const nmeaBatchResult * result, void * arg);
+
+/*----------------------------------------------------------------------------
+ Decode a capture
+
+ Calls callback for every decoded sentence in the order they are in the
+ capture, however many threads are used. Pass 0 threads to use one per
+ online core. Returns the number of results reported, or -1 if memory
+ or a thread couldn't be had (some results may have been reported).
+----------------------------------------------------------------------------*/
+long nmeaBatchDecode(const nmeaChar * data, size_t count, unsigned threads,
+					 nmeaBatchCallback callback, void * arg);
+
+/*----------------------------------------------------------------------------
+ Decode a capture file
+
+ As nmeaBatchDecode(), but memory maps the file a window at a time and
+ decodes straight from the mapping. Works for files of any size. Returns
+ -1 with errno set if the file can't be opened or mapped.
+----------------------------------------------------------------------------*/
+long nmeaBatchMapFile(const char * path, unsigned threads,
+					  nmeaBatchCallback callback, void * arg);
@@ -0,0 +1,703 @@
+/*
+ * NMEA Decoder - Pipeline Benchmark (host build only)
+ *
+ * Generates streams of sentences and feeds them through processNmea() and
+ * decodeNmea() UARTBUFFSIZE chars at a time, as uartHwi would, using the
+ * BIOS stand-ins in nmea_host.h. The mixes are
+ *	gll		GLL only, as from a GPS only receiver
+ *	epoch	10 Hz multi-GNSS epochs: RMC, VTG, GGA, GLL and a GSA per
+ *			constellation every epoch, GSV for GPS, GLONASS, Galileo and
+ *			BeiDou and a ZDA once a second
+ *	badsum	The epoch mix with every other checksum wrong
+ *	unknown	Sentences nothing decodes (proprietary, unknown talkers and
+ *			formatters with no decoder), with a GLL every tenth
+ *
+ * For each mix it reports
+ *	sentences and bytes per second through the whole pipeline, and ns
+ *		per sentence, from the fastest pass over the stream
+ *	ns per sentence for each sentence type, the decoder on its own
+ *		(nmeaDecodeSentence() on sentences framed by nmeaFrameText())
+ *	the most sentences and chars waiting in the queue for decodeNmea(),
+ *		and any overruns
+ *	heap allocated while decoding (there should be none)
+ *	the stack processNmea() and decodeNmea() used, measured by running
+ *		a pass on a thread with a painted stack
+ *
+ * Output is JSON, or CSV with one row per mix (type "*") and per
+ * sentence type, so runs can be compared by script.
+ *
+ * e.g. gcc -O2 -DNMEA_HOST -DNMEA_PACKED_RING nmea_bench.c nmea_dec.c
+ *          -lpthread -o nmeabench
+ *      ./nmeabench [json|csv] [seconds per mix]
+ */
+
+/*
+ *  Include Files
+ */
+#include "nmea_host.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+#include <malloc.h>
+#define NMEA_BENCH_HEAP
+#endif
+#include "ascii_16.h"
+#include "nmea_dec.h"
+
+/*
+ *  Declarations
+ */
+#define NMEA_BENCH_STACK	(256UL << 10)	// Painted stack for the stack pass
+#define NMEA_BENCH_PAINT	0xA5
+#define NMEA_BENCH_TYPES	32				// Most sentence types in one mix
+#define NMEA_BENCH_DECODES	20000			// Decodes per timing of a type, at least
+#define NMEA_BENCH_BEST		5				// Timings of a type to take the best of
+
+typedef struct {
+	nmeaChar * data;
+	size_t length;
+	size_t size;							// Chars allocated
+	Uint32 sentences;
+} nmeaBenchStream;
+
+typedef struct {
+	char name[8];							// Address, or BAD for a bad checksum
+	Uint32 count;							// How many in the stream
+	double nsPerSentence;					// Best time to decode one
+} nmeaBenchType;
+
+typedef struct {
+	const char * mix;
+	Uint32 sentences;
+	size_t bytes;
+	Uint32 passes;
+	double bestPass;						// Seconds
+	Uint16 queueHighWater;					// Sentences waiting for decodeNmea()
+	Uint16 ringHighWater;					// Chars held for them
+	Uint32 overruns;
+	long heapBytes;							// -1 if it can't be measured
+	long stackBytes;
+	Uint16 typeCount;
+	nmeaBenchType type[NMEA_BENCH_TYPES];
+} nmeaBenchResult;
+
+typedef struct {
+	const nmeaBenchStream * stream;			// NULL to measure the thread on its own
+	nmeaBenchResult * result;
+} nmeaBenchStackJob;
+
+/*
+ *  Prototypes
+ */
+double nmeaBenchNow(void);					// Monotonic clock in seconds
+void nmeaBenchAdd(nmeaBenchStream * stream, CSLBool corrupt, const char * format, ...);
+											// Appends a sentence, adding the checksum
+void nmeaBenchTime(char * text, Uint32 tenths);
+											// hhmmss.ss for a time in tenths of a second
+void nmeaBenchGll(nmeaBenchStream * stream);
+void nmeaBenchEpochs(nmeaBenchStream * stream, Uint16 corruptEvery);
+void nmeaBenchUnknown(nmeaBenchStream * stream);
+											// Build the mixes
+void nmeaBenchFeed(const nmeaBenchStream * stream, nmeaBenchResult * water);
+											// One pass through processNmea()/decodeNmea()
+void nmeaBenchPipeline(const nmeaBenchStream * stream, double seconds, nmeaBenchResult * result);
+											// Times passes for the throughput
+void nmeaBenchTypes(const nmeaBenchStream * stream, nmeaBenchResult * result);
+											// Times the decoders type by type
+void * nmeaBenchStackRun(void * arg);
+long nmeaBenchStackUsed(const nmeaBenchStream * stream, nmeaBenchResult * result);
+											// Stack, heap and queue use of a pass
+void nmeaBenchJson(const nmeaBenchResult * result, Uint16 count);
+void nmeaBenchCsv(const nmeaBenchResult * result, Uint16 count);
+
+/*
+ *  Global Variables
+ */
+static nmeaContext nmeaBenchContext;		// For timing the decoders on their own
+
+/*
+ * Routines
+ */
+double nmeaBenchNow(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*----------------------------------------------------------------------------
+ Stream building
+
+ The sentences are written without the '$' and checksum, which are added
+ here. A corrupt sentence gets a checksum one out.
+----------------------------------------------------------------------------*/
+void nmeaBenchAdd(nmeaBenchStream * stream, CSLBool corrupt, const char * format, ...)
+{
+	char line[NMEA_MAXLENGTH + 8];
+	va_list args;
+	Uint16 checksum;
+	int length;
+	int i;
+
+	line[0] = '$';
+	va_start(args, format);
+	length = 1 + vsnprintf(&line[1], NMEA_MAXLENGTH, format, args);
+	va_end(args);
+
+	checksum = 0;
+	for (i = 1; i < length; i++)
+	{
+		checksum ^= (Uint8)line[i];
+	}
+	if (corrupt)
+	{
+		checksum ^= 1;
+	}
+	length += sprintf(&line[length], "*%02X\r\n", checksum);
+
+	if (stream->length + length > stream->size)
+	{
+		stream->size = (stream->size != 0) ? stream->size * 2 : 65536;
+		stream->data = realloc(stream->data, stream->size * sizeof(nmeaChar));
+		if (stream->data == NULL)
+		{
+			perror("nmeabench");
+			exit(1);
+		}
+	}
+
+	for (i = 0; i < length; i++)
+	{
+		stream->data[stream->length++] = (Uint8)line[i];
+	}
+	stream->sentences++;
+}
+
+void nmeaBenchTime(char * text, Uint32 tenths)
+{
+	Uint32 seconds = (tenths / 10) % 86400;
+
+	sprintf(text, "%02lu%02lu%02lu.%lu0", (unsigned long)(seconds / 3600), (unsigned long)((seconds / 60) % 60),
+			(unsigned long)(seconds % 60), (unsigned long)(tenths % 10));
+}
+
+void nmeaBenchGll(nmeaBenchStream * stream)
+{
+	char time[16];
+	Uint32 i;
+
+	for (i = 0; i < 1000; i++)
+	{
+		nmeaBenchTime(time, 452190 + i * 10);
+		nmeaBenchAdd(stream, FALSE, "GPGLL,4916.%06lu,N,12311.%06lu,W,%s,A,A",
+					 (unsigned long)(451234 + i * 7), (unsigned long)(125678 + i * 3), time);
+	}
+}
+
+/*----------------------------------------------------------------------------
+ 100 epochs (10 seconds at 10 Hz) of a four constellation receiver. The
+ satellites in view change every second, the position every epoch. With
+ corruptEvery set, one sentence in every corruptEvery has a bad checksum.
+----------------------------------------------------------------------------*/
+void nmeaBenchEpochs(nmeaBenchStream * stream, Uint16 corruptEvery)
+{
+	static const char * const gsvTalker[4] = { "GP", "GL", "GA", "GB" };
+	static const Uint16 gsvSatellites[4] = { 12, 8, 8, 8 };
+	static const Uint16 gsvFirstPrn[4] = { 1, 65, 1, 1 };
+	char time[16];
+	char satellites[4][80];
+	Uint32 epoch;
+	Uint32 sentence;
+	Uint16 constellation;
+	Uint16 message;
+	Uint16 i;
+	int length;
+
+#define NMEA_BENCH_BAD	(corruptEvery != 0 && (sentence++ % corruptEvery) == 0)
+
+	sentence = 1;
+	for (epoch = 0; epoch < 100; epoch++)
+	{
+		nmeaBenchTime(time, 452190 + epoch);
+
+		nmeaBenchAdd(stream, NMEA_BENCH_BAD, "GNRMC,%s,A,4807.%06lu,N,01131.%06lu,E,%lu.%03lu,084.40,230394,003.1,W,A",
+					 time, (unsigned long)(38123 + epoch * 11), (unsigned long)(456 + epoch * 5),
+					 (unsigned long)(22 + epoch % 3), (unsigned long)(epoch * 37 % 1000));
+		nmeaBenchAdd(stream, NMEA_BENCH_BAD, "GNVTG,084.40,T,081.30,M,%lu.%03lu,N,%lu.%03lu,K,A",
+					 (unsigned long)(22 + epoch % 3), (unsigned long)(epoch * 37 % 1000),
+					 (unsigned long)(41 + epoch % 5), (unsigned long)(epoch * 61 % 1000));
+		nmeaBenchAdd(stream, NMEA_BENCH_BAD, "GNGGA,%s,4807.%06lu,N,01131.%06lu,E,1,%02u,0.9,%lu.%lu,M,46.9,M,,",
+					 time, (unsigned long)(38123 + epoch * 11), (unsigned long)(456 + epoch * 5),
+					 (unsigned)(20 + epoch % 4), (unsigned long)(545 + epoch % 7), (unsigned long)(epoch % 10));
+
+		// One GSA per constellation, listing the first few in view
+		for (constellation = 0; constellation < 4; constellation++)
+		{
+			length = 0;
+			for (i = 0; i < 12; i++)
+			{
+				if (i < gsvSatellites[constellation] - 2)
+				{
+					length += sprintf(&satellites[constellation][length], "%02u,", gsvFirstPrn[constellation] + i);
+				}
+				else
+				{
+					length += sprintf(&satellites[constellation][length], ",");
+				}
+			}
+			nmeaBenchAdd(stream, NMEA_BENCH_BAD, "%sGSA,A,3,%s1.8,0.9,1.5", gsvTalker[constellation],
+						 satellites[constellation]);
+		}
+
+		nmeaBenchAdd(stream, NMEA_BENCH_BAD, "GNGLL,4807.%06lu,N,01131.%06lu,E,%s,A,A",
+					 (unsigned long)(38123 + epoch * 11), (unsigned long)(456 + epoch * 5), time);
+
+		if (epoch % 10 != 0)
+		{
+			continue;
+		}
+
+		// Once a second, the sky, four satellites a GSV
+		for (constellation = 0; constellation < 4; constellation++)
+		{
+			Uint16 messages = (gsvSatellites[constellation] + 3) / 4;
+
+			for (message = 0; message < messages; message++)
+			{
+				length = 0;
+				for (i = message * 4; i < message * 4 + 4 && i < gsvSatellites[constellation]; i++)
+				{
+					length += sprintf(&satellites[0][length], ",%02u,%02u,%03u,%02u", gsvFirstPrn[constellation] + i,
+									  (unsigned)((i * 7 + epoch / 10) % 90), (unsigned)((i * 29 + epoch) % 360),
+									  (unsigned)(20 + (i * 3 + epoch / 10) % 30));
+				}
+				nmeaBenchAdd(stream, NMEA_BENCH_BAD, "%sGSV,%u,%u,%02u%s", gsvTalker[constellation], messages,
+							 message + 1, gsvSatellites[constellation], satellites[0]);
+			}
+		}
+
+		nmeaBenchAdd(stream, NMEA_BENCH_BAD, "GNZDA,%s,23,03,1994,00,00", time);
+	}
+
+#undef NMEA_BENCH_BAD
+}
+
+void nmeaBenchUnknown(nmeaBenchStream * stream)
+{
+	char time[16];
+	Uint32 i;
+
+	for (i = 0; i < 1000; i++)
+	{
+		nmeaBenchTime(time, 452190 + i);
+
+		switch (i % 10)
+		{
+			case 0:
+				nmeaBenchAdd(stream, FALSE, "GPGLL,4916.%06lu,N,12311.%06lu,W,%s,A,A",
+							 (unsigned long)(451234 + i * 7), (unsigned long)(125678 + i * 3), time);
+				break;
+			case 1:
+			case 6:
+				nmeaBenchAdd(stream, FALSE, "PUBX,00,%s,4807.03812,N,01131.00045,E,545.4,G3,2.1,2.0,0.007,77.52,0.007,,0.92,1.19,0.77,9,0,0",
+							 time);
+				break;
+			case 2:
+				nmeaBenchAdd(stream, FALSE, "GPTXT,01,01,02,ANTSTATUS=OK");
+				break;
+			case 3:
+			case 8:
+				nmeaBenchAdd(stream, FALSE, "INHDT,%lu.%lu,T", (unsigned long)(i % 360), (unsigned long)(i % 10));
+				break;
+			case 4:
+				nmeaBenchAdd(stream, FALSE, "GPXTE,A,A,0.67,L,N,A");
+				break;
+			case 5:
+				nmeaBenchAdd(stream, FALSE, "PGRMZ,%lu,f,3", (unsigned long)(1494 + i % 50));
+				break;
+			case 7:
+				nmeaBenchAdd(stream, FALSE, "WIMWV,%lu.0,R,%lu.1,N,A", (unsigned long)(i % 360), (unsigned long)(i % 40));
+				break;
+			default:
+				nmeaBenchAdd(stream, FALSE, "GNDTM,W84,,0.0,N,0.0,E,0.0,W84");
+				break;
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ Feeds a stream through the board's SWIs a UART buffer at a time, running
+ decodeNmea() straight after any processNmea() that posted it. With water
+ set, also notes the most the queue held.
+----------------------------------------------------------------------------*/
+void nmeaBenchFeed(const nmeaBenchStream * stream, nmeaBenchResult * water)
+{
+	nmeaSentenceQueue * queue = &nmeaDefaultContext.queue;
+	size_t position;
+	nmeaChar * buffer;
+	Uns posts;
+	Uint16 count;
+	Uint16 i;
+
+	for (position = 0; position < stream->length; position += count)
+	{
+		// processNmea() runs straight after each hand-over, so there is
+		// always a buffer free
+		buffer = nmeaUartFillBuffer(&nmeaUartInput);
+		count = (stream->length - position > UARTBUFFSIZE) ? UARTBUFFSIZE : (Uint16)(stream->length - position);
+		for (i = 0; i < count; i++)
+		{
+			buffer[i] = stream->data[position + i];
+		}
+
+		nmeaUartHandOver(&nmeaUartInput, count);
+		posts = nmeaHostSwiPosts;
+		processNmea();
+
+		if (water != NULL)
+		{
+			if ((Uint16)(queue->head - queue->tail) > water->queueHighWater)
+			{
+				water->queueHighWater = (Uint16)(queue->head - queue->tail);
+			}
+			if ((Uint16)(queue->dataHead - queue->dataTail) > water->ringHighWater)
+			{
+				water->ringHighWater = (Uint16)(queue->dataHead - queue->dataTail);
+			}
+		}
+
+		if (nmeaHostSwiPosts != posts)
+		{
+			decodeNmea();
+		}
+	}
+}
+
+void nmeaBenchPipeline(const nmeaBenchStream * stream, double seconds, nmeaBenchResult * result)
+{
+	double start;
+	double pass;
+	double end;
+
+	nmeaInitContext(&nmeaDefaultContext);
+
+	// Keep the fastest pass, the rest were disturbed by something
+	result->bestPass = 1e9;
+	result->passes = 0;
+	end = nmeaBenchNow() + seconds;
+	do
+	{
+		start = nmeaBenchNow();
+		nmeaBenchFeed(stream, NULL);
+		pass = nmeaBenchNow() - start;
+
+		if (pass < result->bestPass)
+		{
+			result->bestPass = pass;
+		}
+		result->passes++;
+	} while (start + pass < end || result->passes < 3);
+}
+
+/*----------------------------------------------------------------------------
+ Frames the whole stream, then times each sentence type's decodes on
+ their own. Sentences with a bad checksum are timed as one type, BAD.
+----------------------------------------------------------------------------*/
+void nmeaBenchTypes(const nmeaBenchStream * stream, nmeaBenchResult * result)
+{
+	nmeaSentenceView * views;
+	Uint16 * types;
+	Uint32 viewCount;
+	Uint32 position;
+	Uint32 repeats;
+	Uint32 repeat;
+	Uint32 v;
+	Uint16 type;
+	Uint16 best;
+	Uint16 i;
+	char name[8];
+	double start;
+	double taken;
+
+	views = malloc(stream->sentences * sizeof(nmeaSentenceView));
+	types = malloc(stream->sentences * sizeof(Uint16));
+	if (views == NULL || types == NULL)
+	{
+		perror("nmeabench");
+		exit(1);
+	}
+
+	nmeaInitContext(&nmeaBenchContext);
+
+	viewCount = 0;
+	position = 0;
+	while (viewCount < stream->sentences &&
+		   nmeaFrameText(stream->data, (Uint32)stream->length, &position, &views[viewCount]))
+	{
+		if (views[viewCount].status != NMEA_SENTENCE_GOOD)
+		{
+			strcpy(name, "BAD");
+		}
+		else
+		{
+			// Framed in place, so the address is all in one run
+			for (i = 0; i < 5 && views[viewCount].text[views[viewCount].start + i] != A_COMMA; i++)
+			{
+				name[i] = (char)views[viewCount].text[views[viewCount].start + i];
+			}
+			name[i] = '\0';
+		}
+
+		for (type = 0; type < result->typeCount && strcmp(result->type[type].name, name) != 0; type++)
+		{
+		}
+		if (type == result->typeCount)
+		{
+			if (type == NMEA_BENCH_TYPES)
+			{
+				continue;
+			}
+			strcpy(result->type[type].name, name);
+			result->typeCount++;
+		}
+
+		result->type[type].count++;
+		types[viewCount++] = type;
+	}
+
+	for (type = 0; type < result->typeCount; type++)
+	{
+		repeats = (NMEA_BENCH_DECODES + result->type[type].count - 1) / result->type[type].count;
+		result->type[type].nsPerSentence = 1e9;
+
+		for (best = 0; best < NMEA_BENCH_BEST; best++)
+		{
+			start = nmeaBenchNow();
+			for (repeat = 0; repeat < repeats; repeat++)
+			{
+				for (v = 0; v < viewCount; v++)
+				{
+					if (types[v] == type)
+					{
+						nmeaDecodeSentence(&nmeaBenchContext, &views[v]);
+					}
+				}
+			}
+			taken = (nmeaBenchNow() - start) * 1e9 / ((double)repeats * result->type[type].count);
+
+			if (taken < result->type[type].nsPerSentence)
+			{
+				result->type[type].nsPerSentence = taken;
+			}
+		}
+	}
+
+	free(types);
+	free(views);
+}
+
+/*----------------------------------------------------------------------------
+ Runs one pass on a thread whose stack has been painted, and counts how
+ much of the paint was overwritten. The thread's own start up, and the
+ heap check, are measured with an empty job and taken off.
+----------------------------------------------------------------------------*/
+void * nmeaBenchStackRun(void * arg)
+{
+	nmeaBenchStackJob * job = arg;
+#ifdef NMEA_BENCH_HEAP
+	struct mallinfo2 before;
+
+	before = mallinfo2();
+#endif
+
+	if (job->stream == NULL)
+	{
+		return NULL;
+	}
+
+	nmeaInitContext(&nmeaDefaultContext);
+
+#ifdef NMEA_BENCH_HEAP
+	nmeaBenchFeed(job->stream, job->result);
+	job->result->heapBytes = (long)(mallinfo2().uordblks - before.uordblks);
+#else
+	nmeaBenchFeed(job->stream, job->result);
+	job->result->heapBytes = -1;
+#endif
+	job->result->overruns = nmeaDefaultContext.queue.overruns;
+
+	return NULL;
+}
+
+long nmeaBenchStackUsed(const nmeaBenchStream * stream, nmeaBenchResult * result)
+{
+	nmeaBenchStackJob job;
+	pthread_attr_t attr;
+	pthread_t thread;
+	Uint8 * stack;
+	size_t untouched;
+
+	if (posix_memalign((void **)&stack, 4096, NMEA_BENCH_STACK) != 0)
+	{
+		return -1;
+	}
+	memset(stack, NMEA_BENCH_PAINT, NMEA_BENCH_STACK);
+
+	job.stream = stream;
+	job.result = result;
+
+	pthread_attr_init(&attr);
+	if (pthread_attr_setstack(&attr, stack, NMEA_BENCH_STACK) != 0 ||
+		pthread_create(&thread, &attr, nmeaBenchStackRun, &job) != 0)
+	{
+		pthread_attr_destroy(&attr);
+		free(stack);
+		return -1;
+	}
+	pthread_join(thread, NULL);
+	pthread_attr_destroy(&attr);
+
+	// The stack grows down, so the paint left at the bottom is what was
+	// never reached
+	for (untouched = 0; untouched < NMEA_BENCH_STACK && stack[untouched] == NMEA_BENCH_PAINT; untouched++)
+	{
+	}
+	free(stack);
+
+	return (long)(NMEA_BENCH_STACK - untouched);
+}
+
+/*----------------------------------------------------------------------------
+ Output
+----------------------------------------------------------------------------*/
+void nmeaBenchJson(const nmeaBenchResult * result, Uint16 count)
+{
+	Uint16 mix;
+	Uint16 type;
+
+	printf("{\n  \"build\": {\"uartBuffSize\": %d, \"nmeaBuffSize\": %d, \"sentenceQueue\": %d, \"packedRing\": %s},\n",
+		   UARTBUFFSIZE, NMEABUFFSIZE, NMEASENTBUFFSIZE, (sizeof(nmeaChar) == 1) ? "true" : "false");
+	printf("  \"mixes\": [\n");
+
+	for (mix = 0; mix < count; mix++, result++)
+	{
+		printf("    {\"mix\": \"%s\", \"sentences\": %lu, \"bytes\": %lu, \"passes\": %lu,\n",
+			   result->mix, (unsigned long)result->sentences, (unsigned long)result->bytes,
+			   (unsigned long)result->passes);
+		printf("     \"sentencesPerSecond\": %.0f, \"bytesPerSecond\": %.0f, \"nsPerSentence\": %.1f,\n",
+			   result->sentences / result->bestPass, result->bytes / result->bestPass,
+			   result->bestPass * 1e9 / result->sentences);
+		printf("     \"queueHighWater\": %u, \"ringHighWater\": %u, \"overruns\": %lu, \"heapBytes\": %ld, \"stackBytes\": %ld,\n",
+			   result->queueHighWater, result->ringHighWater, (unsigned long)result->overruns,
+			   result->heapBytes, result->stackBytes);
+		printf("     \"types\": [");
+
+		for (type = 0; type < result->typeCount; type++)
+		{
+			printf("%s\n       {\"type\": \"%s\", \"count\": %lu, \"nsPerSentence\": %.1f}", (type != 0) ? "," : "",
+				   result->type[type].name, (unsigned long)result->type[type].count, result->type[type].nsPerSentence);
+		}
+
+		printf("]}%s\n", (mix + 1 < count) ? "," : "");
+	}
+
+	printf("  ]\n}\n");
+}
+
+void nmeaBenchCsv(const nmeaBenchResult * result, Uint16 count)
+{
+	Uint16 mix;
+	Uint16 type;
+
+	printf("mix,type,sentences,bytes,sentencesPerSecond,bytesPerSecond,nsPerSentence,"
+		   "queueHighWater,ringHighWater,overruns,heapBytes,stackBytes\n");
+
+	for (mix = 0; mix < count; mix++, result++)
+	{
+		printf("%s,*,%lu,%lu,%.0f,%.0f,%.1f,%u,%u,%lu,%ld,%ld\n", result->mix,
+			   (unsigned long)result->sentences, (unsigned long)result->bytes,
+			   result->sentences / result->bestPass, result->bytes / result->bestPass,
+			   result->bestPass * 1e9 / result->sentences, result->queueHighWater, result->ringHighWater,
+			   (unsigned long)result->overruns, result->heapBytes, result->stackBytes);
+
+		for (type = 0; type < result->typeCount; type++)
+		{
+			printf("%s,%s,%lu,,,,%.1f,,,,,\n", result->mix, result->type[type].name,
+				   (unsigned long)result->type[type].count, result->type[type].nsPerSentence);
+		}
+	}
+}
+
+int main(int argc, char * argv[])
+{
+	static const char * const mixes[] = { "gll", "epoch", "badsum", "unknown" };
+	static nmeaBenchResult results[sizeof(mixes) / sizeof(mixes[0])];
+	nmeaBenchStream stream;
+	CSLBool csv;
+	double seconds;
+	long baseline;
+	Uint16 mix;
+
+	csv = (argc > 1 && strcmp(argv[1], "csv") == 0);
+	seconds = (argc > 2) ? atof(argv[2]) : 1.0;
+	if (argc > 1 && !csv && strcmp(argv[1], "json") != 0)
+	{
+		fprintf(stderr, "usage: %s [json|csv] [seconds per mix]\n", argv[0]);
+		return 2;
+	}
+
+	// Once so that anything the thread calls is linked in, then for real
+	nmeaBenchStackUsed(NULL, NULL);
+	baseline = nmeaBenchStackUsed(NULL, NULL);
+
+	for (mix = 0; mix < sizeof(mixes) / sizeof(mixes[0]); mix++)
+	{
+		memset(&stream, 0, sizeof(stream));
+		switch (mix)
+		{
+			case 0:
+				nmeaBenchGll(&stream);
+				break;
+			case 1:
+				nmeaBenchEpochs(&stream, 0);
+				break;
+			case 2:
+				nmeaBenchEpochs(&stream, 2);
+				break;
+			default:
+				nmeaBenchUnknown(&stream);
+				break;
+		}
+
+		results[mix].mix = mixes[mix];
+		results[mix].sentences = stream.sentences;
+		results[mix].bytes = stream.length;
+
+		// The timed passes come first so that nothing (e.g. the dynamic
+		// linker) runs for the first time on the painted stack
+		nmeaBenchPipeline(&stream, seconds, &results[mix]);
+		results[mix].stackBytes = nmeaBenchStackUsed(&stream, &results[mix]);
+		if (results[mix].stackBytes >= 0 && baseline >= 0)
+		{
+			results[mix].stackBytes -= baseline;
+		}
+		nmeaBenchTypes(&stream, &results[mix]);
+
+		free(stream.data);
+	}
+
+	if (csv)
+	{
+		nmeaBenchCsv(results, mix);
+	}
+	else
+	{
+		nmeaBenchJson(results, mix);
+	}
+
+	return 0;
+}
@@ -0,0 +1,399 @@
+/*
+ * NMEA Decoder - Epoch Assembler Checks (host build only)
+ *
+ * Feeds made up sentence sequences through processNmea() and decodeNmea()
+ * on one context and checks the epochs that come out, for the orders
+ * receivers send them in that the assembler has got wrong before:
+ *
+ *	gsa		GPS and GLONASS GSAs after each GGA, one satellite more in
+ *			the GLONASS one each epoch. Every epoch must have both GSAs'
+ *			satellites, none carried into the next.
+ *	notime	A GGA with an empty time field after an RMC. It belongs
+ *			with the RMC, not to an epoch at 00:00:00.
+ *
+ * that nmeaReadRecord() counts only the records actually written:
+ *
+ *	writes	Good GLLs, one with a bad latitude and part of a GSV cycle.
+ *			Only the good GLLs and the whole cycle move the counts on.
+ *
+ * and that processNmea() and nmeaFrameText() frame the same text alike:
+ *
+ *	frame	Sentences either side of NMEA_MAXLENGTH, one straight after
+ *			another's checksum, a '$' part way through one, bad
+ *			checksums and junk, through nmeaProcessContext() a random
+ *			sized buffer at a time and through nmeaFrameText() in one
+ *			go. Both must frame the same sentences, field for field.
+ *
+ * e.g. gcc -O2 -DNMEA_HOST -DNMEA_PACKED_RING nmea_check.c nmea_dec.c
+ *          -lpthread -o nmeacheck
+ *      ./nmeacheck
+ */
+
+/*
+ *  Include Files
+ */
+#include "nmea_host.h"
+#include <stdlib.h>
+#include <string.h>
+#include "ascii_16.h"
+#include "nmea_dec.h"
+
+/*
+ *  Declarations
+ */
+#define NMEA_CHECK_EPOCHS		8			// Most epochs a check looks at
+#define NMEA_CHECK_TEXT			2048		// Most text the frame check sends
+#define NMEA_CHECK_FRAMED		32			// Most sentences it compares
+
+typedef struct {
+	Uint16 count;							// Epochs reported
+	nmeaEpochFix epoch[NMEA_CHECK_EPOCHS];
+} nmeaCheckEpochs;
+
+typedef struct {
+	Uint16 count;							// Sentences framed
+	nmeaSentenceView view[NMEA_CHECK_FRAMED];
+	char text[NMEA_CHECK_FRAMED][NMEA_MAXLENGTH + 1];
+} nmeaCheckFramed;
+
+Uint16 nmeaViewChar(const nmeaSentenceView * view, Uint16 offset);
+											// From nmea_dec.c
+
+/*
+ *  Prototypes
+ */
+void nmeaCheckSend(nmeaContext * context, const char * body);
+											// Frames and decodes one sentence
+void nmeaCheckKeep(Uint16 event, const void * record, void * arg);
+											// Keeps each epoch reported
+void nmeaCheckAdd(char * text, Uint16 * length, const char * body, const char * after);
+											// Adds a sentence to a block of text
+void nmeaCheckNote(nmeaCheckFramed * framed, const nmeaSentenceView * view);
+											// Keeps a copy of a framed sentence
+int nmeaCheckGsa(void);						// The checks, each returns failures
+int nmeaCheckNoTime(void);
+int nmeaCheckWrites(void);
+int nmeaCheckFrame(void);
+
+/*----------------------------------------------------------------------------
+ Adds the '$', checksum and CR LF to body and puts it through the context
+----------------------------------------------------------------------------*/
+void nmeaCheckSend(nmeaContext * context, const char * body)
+{
+	nmeaChar data[NMEA_MAXLENGTH + 8];
+	char line[NMEA_MAXLENGTH + 8];
+	Uint16 checksum;
+	Uint16 length;
+	Uint16 i;
+
+	checksum = 0;
+	for (i = 0; body[i] != 0; i++)
+	{
+		checksum ^= (Uint8)body[i];
+	}
+
+	length = (Uint16)sprintf(line, "$%s*%02X\r\n", body, checksum);
+	for (i = 0; i < length; i++)
+	{
+		data[i] = (nmeaChar)line[i];
+	}
+
+	nmeaProcessContext(context, data, length);
+	nmeaDecodeContext(context);
+}
+
+void nmeaCheckKeep(Uint16 event, const void * record, void * arg)
+{
+	nmeaCheckEpochs * epochs = arg;
+
+	if (epochs->count < NMEA_CHECK_EPOCHS)
+	{
+		epochs->epoch[epochs->count] = *(const nmeaEpochFix *)record;
+	}
+	epochs->count++;
+}
+
+/*----------------------------------------------------------------------------
+ One GSA per constellation
+----------------------------------------------------------------------------*/
+int nmeaCheckGsa(void)
+{
+	static nmeaContext context NMEA_CACHE_ALIGN;
+	nmeaCheckEpochs epochs;
+	char body[NMEA_MAXLENGTH];
+	Uint16 e;
+	Uint16 i;
+	int failed;
+
+	memset(&epochs, 0, sizeof(epochs));
+	nmeaInitContext(&context);
+	nmeaSubscribe(&context, NMEA_EVENT_EPOCH, nmeaCheckKeep, &epochs);
+
+	for (e = 0; e < 5; e++)
+	{
+		sprintf(body, "GPRMC,1200%02u,A,4916.45,N,12311.12,W,000.5,054.7,191194,020.3,E", e);
+		nmeaCheckSend(&context, body);
+		// GGA's own count must not survive the GSAs
+		sprintf(body, "GPGGA,1200%02u,4807.038,N,01131.000,E,1,99,0.9,545.4,M,46.9,M,,", e);
+		nmeaCheckSend(&context, body);
+		nmeaCheckSend(&context, "GPGSA,A,3,04,05,09,12,,,,,,,,,2.5,1.3,2.1");
+
+		// GLONASS uses e + 1 satellites, 65 on, the other fields empty
+		strcpy(body, "GLGSA,A,3");
+		for (i = 0; i < 12; i++)
+		{
+			if (i <= e)
+			{
+				sprintf(body + strlen(body), ",%u", 65 + i);
+			}
+			else
+			{
+				strcat(body, ",");
+			}
+		}
+		strcat(body, ",2.5,1.3,2.1");
+		nmeaCheckSend(&context, body);
+	}
+
+	// The first epoch goes to its deadline, the rest are complete as soon
+	// as their GLONASS GSA is in
+	failed = (epochs.count != 5);
+	for (e = 0; e < epochs.count && e < 5; e++)
+	{
+		if (epochs.epoch[e].usedCount != 5 + e || epochs.epoch[e].utcGpsTime.utcSeconds != e)
+		{
+			failed = 1;
+		}
+		printf("gsa     %02d:%02d:%02d used %d\n", epochs.epoch[e].utcGpsTime.utcHours,
+			   epochs.epoch[e].utcGpsTime.utcMinutes, epochs.epoch[e].utcGpsTime.utcSeconds,
+			   epochs.epoch[e].usedCount);
+	}
+
+	return failed;
+}
+
+/*----------------------------------------------------------------------------
+ A sentence without a time
+----------------------------------------------------------------------------*/
+int nmeaCheckNoTime(void)
+{
+	static nmeaContext context NMEA_CACHE_ALIGN;
+	nmeaCheckEpochs epochs;
+	Uint16 e;
+	int failed;
+
+	memset(&epochs, 0, sizeof(epochs));
+	nmeaInitContext(&context);
+	nmeaSubscribe(&context, NMEA_EVENT_EPOCH, nmeaCheckKeep, &epochs);
+
+	// Two whole epochs so the assembler knows what one has, then one
+	// whose GGA has no time and a last one to end it
+	nmeaCheckSend(&context, "GPRMC,115958,A,4916.45,N,12311.12,W,000.5,054.7,191194,020.3,E");
+	nmeaCheckSend(&context, "GPGGA,115958,4807.038,N,01131.000,E,1,04,0.9,545.4,M,46.9,M,,");
+	nmeaCheckSend(&context, "GPRMC,115959,A,4916.45,N,12311.12,W,000.5,054.7,191194,020.3,E");
+	nmeaCheckSend(&context, "GPGGA,115959,4807.038,N,01131.000,E,1,04,0.9,545.4,M,46.9,M,,");
+	nmeaCheckSend(&context, "GPRMC,120000,A,4916.45,N,12311.12,W,000.5,054.7,191194,020.3,E");
+	nmeaCheckSend(&context, "GPGGA,,4807.038,N,01131.000,E,1,07,0.9,545.4,M,46.9,M,,");
+	nmeaCheckSend(&context, "GPRMC,120001,A,4916.45,N,12311.12,W,000.5,054.7,191194,020.3,E");
+
+	// The empty time must neither start an epoch of its own nor end the
+	// 12:00:00 one early
+	failed = (epochs.count != 3 || epochs.epoch[2].usedCount != 7 ||
+			  epochs.epoch[2].events != (NMEA_EVENT_NAVIGATION | NMEA_EVENT_FIX));
+	for (e = 0; e < epochs.count && e < NMEA_CHECK_EPOCHS; e++)
+	{
+		printf("notime  %lu used %d events %02x\n", (unsigned long)epochs.epoch[e].utcEpoch,
+			   epochs.epoch[e].usedCount, epochs.epoch[e].events);
+	}
+
+	return failed;
+}
+
+/*----------------------------------------------------------------------------
+ Sentences that write their record and sentences that don't
+----------------------------------------------------------------------------*/
+int nmeaCheckWrites(void)
+{
+	static nmeaContext context NMEA_CACHE_ALIGN;
+	nmeaGeographicPosition position;
+	nmeaSkyTable sky;
+	Uint16 written[6];
+	int failed;
+
+	nmeaInitContext(&context);
+
+	nmeaCheckSend(&context, "GPGLL,4916.45,N,12311.12,W,225444,A");
+	written[0] = nmeaReadRecord(&context, NMEA_EVENT_POSITION, &position);
+	// Dropped as malformed, the last position stands
+	nmeaCheckSend(&context, "GPGLL,49x6.45,N,12311.12,W,225445,A");
+	written[1] = nmeaReadRecord(&context, NMEA_EVENT_POSITION, &position);
+	nmeaCheckSend(&context, "GPGLL,4916.45,N,12311.12,W,225446,A");
+	written[2] = nmeaReadRecord(&context, NMEA_EVENT_POSITION, &position);
+
+	// Only the last of a cycle writes the sky table
+	nmeaCheckSend(&context, "GPGSV,2,1,05,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00");
+	written[3] = nmeaReadRecord(&context, NMEA_EVENT_SATELLITES, &sky);
+	nmeaCheckSend(&context, "GPGSV,2,2,05,14,25,170,00");
+	written[4] = nmeaReadRecord(&context, NMEA_EVENT_SATELLITES, &sky);
+	written[5] = nmeaReadRecord(&context, NMEA_EVENT_POSITION, &position);
+
+	failed = (written[0] != 1 || written[1] != 1 || written[2] != 2 ||
+			  written[3] != 0 || written[4] != 1 || written[5] != 2 ||
+			  position.utcGpsTime.utcSeconds != 46 || sky.count != 5);
+	printf("writes  position %d %d %d sky %d %d position %d\n", written[0], written[1],
+		   written[2], written[3], written[4], written[5]);
+
+	return failed;
+}
+
+/*----------------------------------------------------------------------------
+ Adds body to text as a sentence, with its '$' and checksum, then after
+----------------------------------------------------------------------------*/
+void nmeaCheckAdd(char * text, Uint16 * length, const char * body, const char * after)
+{
+	Uint16 checksum;
+	Uint16 i;
+
+	checksum = 0;
+	for (i = 0; body[i] != 0; i++)
+	{
+		checksum ^= (Uint8)body[i];
+	}
+
+	*length += (Uint16)sprintf(text + *length, "$%s*%02X%s", body, checksum, after);
+}
+
+void nmeaCheckNote(nmeaCheckFramed * framed, const nmeaSentenceView * view)
+{
+	Uint16 i;
+
+	if (framed->count < NMEA_CHECK_FRAMED)
+	{
+		framed->view[framed->count] = *view;
+		for (i = 0; i < view->length; i++)
+		{
+			framed->text[framed->count][i] = (char)nmeaViewChar(view, i);
+		}
+		framed->text[framed->count][i] = 0;
+	}
+	framed->count++;
+}
+
+/*----------------------------------------------------------------------------
+ The two framers
+----------------------------------------------------------------------------*/
+int nmeaCheckFrame(void)
+{
+	static nmeaContext context NMEA_CACHE_ALIGN;
+	static nmeaCheckFramed uart;
+	static nmeaCheckFramed text;
+	static nmeaChar data[NMEA_CHECK_TEXT];
+	char stream[NMEA_CHECK_TEXT];
+	char body[NMEA_MAXLENGTH + 8];
+	nmeaSentenceView view;
+	nmeaSentenceView * sentence;
+	Uint32 position;
+	Uint32 seed;
+	Uint16 length;
+	Uint16 fed;
+	Uint16 held;
+	Uint16 n;
+	Uint16 i;
+	int failed;
+
+	length = 0;
+	nmeaCheckAdd(stream, &length, "GPGLL,4916.45,N,12311.12,W,225444,A", "\r\n");
+
+	// Bodies one short of, at and one over NMEA_MAXLENGTH
+	for (n = NMEA_MAXLENGTH - 1; n <= NMEA_MAXLENGTH + 1; n++)
+	{
+		strcpy(body, "GPTXT,01,01,01,");
+		while (strlen(body) < n)
+		{
+			strcat(body, "A");
+		}
+		nmeaCheckAdd(stream, &length, body, "\r\n");
+	}
+
+	// No CR LF between sentences, then a '$' part way through one
+	nmeaCheckAdd(stream, &length, "GPGLL,4916.45,N,12311.12,W,225445,A", "");
+	nmeaCheckAdd(stream, &length, "GPGLL,4916.45,N,12311.12,W,225446,A", "");
+	length += (Uint16)sprintf(stream + length, "$GPGSA,A,3,04,05");
+	nmeaCheckAdd(stream, &length, "GPGLL,4916.45,N,12311.12,W,225447,A", "\r\n");
+
+	// A bad checksum, junk, and a sentence with more fields than indexed
+	length += (Uint16)sprintf(stream + length, "$GPGLL,4916.45,N,12311.12,W,225448,A*00\r\nxx**$\r\n");
+	nmeaCheckAdd(stream, &length, "GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00,14,,,,15,,,,16,,,", "\r\n");
+	nmeaCheckAdd(stream, &length, "GPGLL,4916.45,N,12311.12,W,225449,A", "\r\n");
+
+	for (i = 0; i < length; i++)
+	{
+		data[i] = (nmeaChar)stream[i];
+	}
+
+	// A random sized UART buffer at a time, drained as it goes
+	memset(&uart, 0, sizeof(uart));
+	nmeaInitContext(&context);
+	seed = 12345;
+	for (fed = 0; fed < length; fed += held)
+	{
+		seed = seed * 1103515245UL + 12345;
+		held = (Uint16)(1 + (seed >> 16) % UARTBUFFSIZE);
+		if (held > length - fed)
+		{
+			held = length - fed;
+		}
+		nmeaProcessContext(&context, &data[fed], held);
+
+		while ((sentence = nmeaQueuePeek(&context.queue)) != NULL)
+		{
+			nmeaCheckNote(&uart, sentence);
+			nmeaQueueRelease(&context.queue);
+		}
+	}
+
+	// All in one go
+	memset(&text, 0, sizeof(text));
+	position = 0;
+	while (nmeaFrameText(data, length, &position, &view))
+	{
+		nmeaCheckNote(&text, &view);
+	}
+
+	failed = (uart.count != text.count || uart.count > NMEA_CHECK_FRAMED);
+	for (n = 0; n < uart.count && n < text.count && n < NMEA_CHECK_FRAMED; n++)
+	{
+		if (uart.view[n].status != text.view[n].status ||
+			uart.view[n].length != text.view[n].length ||
+			uart.view[n].fieldCount != text.view[n].fieldCount ||
+			strcmp(uart.text[n], text.text[n]) != 0)
+		{
+			failed = 1;
+		}
+		for (i = 0; i <= uart.view[n].fieldCount && i <= NMEA_MAXFIELDS; i++)
+		{
+			if (uart.view[n].field[i] != text.view[n].field[i])
+			{
+				failed = 1;
+			}
+		}
+		printf("frame   %d %3d %.20s\n", uart.view[n].status, uart.view[n].length, uart.text[n]);
+	}
+	printf("frame   %d framed by processNmea(), %d by nmeaFrameText()\n", uart.count, text.count);
+
+	return failed;
+}
+
+int main(void)
+{
+	int failed;
+
+	failed = 0;
+	failed += nmeaCheckGsa();
+	failed += nmeaCheckNoTime();
+	failed += nmeaCheckWrites();
+	failed += nmeaCheckFrame();
+
+	printf("%s\n", failed ? "FAILED" : "passed");
+	return failed ? 1 : 0;
+}
@@ -6,25 +6,136 @@
 /*
  *  Include Files
  */
+#ifdef NMEA_HOST
+#include "nmea_host.h"
+#else
 #include <std.h>
 #include <csl.h>
 #include <swi.h>
 #include <log.h>
+#include <clk.h>
 #include "..\audioappcfg.h"
+#endif
+#include <string.h>
 #include "ascii_16.h"
 #include "nmea_dec.h"
+#ifndef NMEA_HOST
 #include "dsk5510_tl16c750.h"
+#endif
+#ifndef NMEA_INLINE
+#define NMEA_INLINE							// Plain functions on the DSP
+#endif
+
+// Progress and error messages are only built in with NMEA_VERBOSE, and then
+// go in the context's trace ring to be formatted by nmeaDrainTrace() later.
+// The counters in nmeaStats are always kept
+#ifdef NMEA_VERBOSE
+#define NMEA_TRACE(context, side, id, arg0, arg1, arg2, arg3)					\
+	{																			\
+		nmeaTraceRing * nmeaRing = &(context)->trace[side];						\
+		nmeaTraceEntry * nmeaEntry = &nmeaRing->entry[nmeaRing->head & (NMEA_TRACE_SIZE - 1)];	\
+		nmeaEntry->time = CLK_getltime();										\
+		nmeaEntry->event = (id);												\
+		nmeaEntry->arg[0] = (Uint16)(arg0);										\
+		nmeaEntry->arg[1] = (Uint16)(arg1);										\
+		nmeaEntry->arg[2] = (Uint16)(arg2);										\
+		nmeaEntry->arg[3] = (Uint16)(arg3);										\
+		NMEA_RELEASE();															\
+		nmeaRing->head++;														\
+	}
+#else
+#define NMEA_TRACE(context, side, id, arg0, arg1, arg2, arg3)
+#endif
+
+typedef struct {
+	Uint32		address;
+	nmeaDecoder	decoder;
+	Uint16		events;						// What the decoder can report
+} nmeaDispatchEntry;
 
 /* 
  *  Prototypes
  */
 void processNmea(void);						// Processes NMEA messages and checks checksum
 void decodeNmea(void);						// Decodes the NMEA and extracts the content
+void nmeaLocationCheck(Uint16 event, const void * record, void * arg);
+											// Wakes whoever waits on locationCheckSem
 Uint16 asciiToHex(Uint16 ascii);			// Converts ASCII to Hex
-void incDataPointer(Uint16 * pointer);		// Increments the data pointer and keeps it inside
-											// the circular buffer
-void GPGSV_decode(void);					// Decode GPGSV messages
-void GPGLL_decode(void);					// Decode GPGLL messages
+Uint16 nmeaViewChar(const nmeaSentenceView * view, Uint16 offset);
+											// Reads a sentence character in place
+Uint16 nmeaFieldLength(const nmeaSentenceView * view, Uint16 field);
+											// Length of field N, 0 if empty or missing
+NMEA_INLINE Uint16 nmeaParseDigits(const nmeaChar * text, Uint16 count, Uint32 * value);
+											// Reads up to 8 leading ASCII digits
+NMEA_INLINE const nmeaChar * nmeaFieldText(const nmeaSentenceView * view, Uint16 field, Uint16 * length, nmeaChar * copy);
+											// Field N's characters in one run
+CSLBool nmeaFieldToNumber(const nmeaSentenceView * view, Uint16 field, Uint16 places, Int32 * value);
+											// Reads a [-]x.x field as fixed point
+NMEA_INLINE CSLBool nmeaFieldToUint(const nmeaSentenceView * view, Uint16 field, Uint16 * value);
+											// Reads the whole part of field N
+CSLBool nmeaFieldToPairs(const nmeaSentenceView * view, Uint16 field, Uint16 * first, Uint16 * second, Uint16 * third);
+											// Reads a hhmmss or ddmmyy field
+CSLBool nmeaFieldToCoordParts(const nmeaSentenceView * view, Uint16 field, Uint16 degreeDigits, Uint16 places,
+							  Uint32 * degrees, Uint32 * minutes, Uint32 * fraction);
+											// Reads a lat/long field's parts
+CSLBool nmeaFieldToCoord(const nmeaSentenceView * view, Uint16 field, Uint16 degreeDigits, gpsCoord * coord, Int32 * e7);
+											// Reads a lat/long and N/S/E/W field pair
+											// as a gpsCoord and 1e-7 degrees
+CSLBool nmeaFieldToTime(const nmeaSentenceView * view, Uint16 field, utcTime * time);
+											// Reads a hhmmss.ss field
+Uint32 nmeaEpochSeconds(Uint16 year, Uint16 month, Uint16 day, const utcTime * time);
+											// Date and time to seconds since 1970
+Uint16 nmeaFieldToChar(const nmeaSentenceView * view, Uint16 field, Uint16 missing);
+											// Reads a single character field
+Uint16 nmeaFieldToStatus(const nmeaSentenceView * view, Uint16 field, Uint16 missing);
+											// Reads an A/V status field
+CSLBool nmeaFieldToFixedEW(const nmeaSentenceView * view, Uint16 field, Uint16 places, Int32 missing, Int32 * value);
+											// Reads a value and E/W field pair
+CSLBool nmeaFieldToEpoch(const nmeaSentenceView * view, Uint16 field, Uint16 timeField, Uint32 * epoch);
+											// Reads a ddmmyy date and time as
+											// seconds since 1970
+CSLBool nmeaFieldToEpochDMY(const nmeaSentenceView * view, Uint16 field, Uint16 timeField, Uint32 * epoch);
+											// Reads a day, month and year
+											// field triple and time the same way
+Uint16 GPGSV_decode(nmeaContext * context, const nmeaSentenceView * sentence);
+											// Decode GPGSV messages
+Uint16 GPGLL_decode(nmeaContext * context, const nmeaSentenceView * sentence);
+											// Decode GPGLL messages
+Uint16 GPGGA_decode(nmeaContext * context, const nmeaSentenceView * sentence);
+											// Decode GPGGA messages
+Uint16 GPRMC_decode(nmeaContext * context, const nmeaSentenceView * sentence);
+											// Decode GPRMC messages
+Uint16 GPGSA_decode(nmeaContext * context, const nmeaSentenceView * sentence);
+											// Decode GPGSA messages
+Uint16 GPVTG_decode(nmeaContext * context, const nmeaSentenceView * sentence);
+											// Decode GPVTG messages
+Uint16 GPZDA_decode(nmeaContext * context, const nmeaSentenceView * sentence);
+											// Decode GPZDA messages
+Uint16 nmeaDispatchHash(Uint32 address);	// Start slot for an address in nmeaDispatch
+const nmeaDispatchEntry * nmeaDispatchLookup(Uint32 address);
+											// Exact match in nmeaDispatch
+const nmeaDispatchEntry * nmeaFindEntry(Uint32 address);
+											// As nmeaFindDecoder(), with its events
+void nmeaNotify(nmeaContext * context, Uint16 events);
+											// Calls the subscribers to events
+void nmeaSequenceStep(nmeaContext * context, Uint16 events);
+											// Moves on the records' sequence numbers
+void nmeaSequenceBack(nmeaContext * context, Uint16 events);
+											// Undoes a step for records not written
+Uint16 nmeaEventIndex(Uint16 event);		// Bit number of a single event bit
+CSLBool nmeaAccepted(const nmeaContext * context);
+											// Is the sentence being framed on the accept list?
+Uint16 nmeaEpochAdd(nmeaContext * context, Uint16 events);
+											// Merges a decoded sentence into its epoch
+Uint16 nmeaEpochPublish(nmeaContext * context);
+											// Reports the epoch being put together
+Uint16 nmeaSkyHash(Uint16 constellation, Uint16 prn);
+											// Start entry for a satellite in the sky index
+void nmeaGsvDrop(nmeaContext * context);	// Drops a partly collected GSV cycle
+void nmeaGsvPublish(nmeaContext * context);
+											// Moves a whole GSV cycle into the sky table
+void nmeaRegisterDefaults(void);			// Registers the decoders in this file
+void nmeaDispatchSetUp(void);				// Calls nmeaRegisterDefaults() just the once
 
 /*
  *  Debugging functions for NMEA display
@@ -32,11 +143,31 @@ void GPGLL_decode(void);					// Decode GPGLL messages
 
 //#define OUTPUT_GPGSV_DATA
 #ifdef OUTPUT_GPGSV_DATA
-void outputGPGSV(void);
+void outputGPGSV(nmeaContext * context);
 #endif
-#define OUTPUT_GPGLL_DATA
+//#define OUTPUT_GPGLL_DATA
 #ifdef OUTPUT_GPGLL_DATA
-void outputGPGLL(void);
+void outputGPGLL(nmeaContext * context);
+#endif
+//#define OUTPUT_GPGGA_DATA
+#ifdef OUTPUT_GPGGA_DATA
+void outputGPGGA(nmeaContext * context);
+#endif
+//#define OUTPUT_GPRMC_DATA
+#ifdef OUTPUT_GPRMC_DATA
+void outputGPRMC(nmeaContext * context);
+#endif
+//#define OUTPUT_GPGSA_DATA
+#ifdef OUTPUT_GPGSA_DATA
+void outputGPGSA(nmeaContext * context);
+#endif
+//#define OUTPUT_GPVTG_DATA
+#ifdef OUTPUT_GPVTG_DATA
+void outputGPVTG(nmeaContext * context);
+#endif
+//#define OUTPUT_GPZDA_DATA
+#ifdef OUTPUT_GPZDA_DATA
+void outputGPZDA(nmeaContext * context);
 #endif
 
 
@@ -44,22 +175,23 @@ void outputGPGLL(void);
 /*
  *  Declarations
  */
-#define NMEABUFFSIZE		256				// Should hold one and 1/2 complete messages
-											// keep a ^2 - circular buffer!!!
-#define UARTBUFFSIZE		64				// Dependent on UART settings
+#define NMEADISPATCHSIZE	64				// Decoder lookup table, keep at least twice
+											// the number of decoders, and a ^2!!!
 
 /*
  *  Global Variables
  */
-Uint16 nmeaBuffer[NMEABUFFSIZE];			// Circular buffer to store messages
-//Uint16 nmeaDataIn = 0;						// Pointer to circ buffer input
-Uint16 nmeaDataOut = 0;						// Pointer to circ buffer output
-extern Uint16 uartDataBuffer[UARTBUFFSIZE];		// UART buffer contents as acquired by uartHwi
-
-nmeaSatelliteInView satsInView[12];			// Twelve structs to store sat-in-view info (GPGSV)
-Uint16 satellitesInView;					// How many satellites we can see
-
-nmeaGeographicPosition geographicPos;		// Structure holding out position & time (GPGLL)
+nmeaContext nmeaDefaultContext;				// Receiver behind processNmea() and decodeNmea()
+CSLBool nmeaDefaultReady = FALSE;			// nmeaDefaultContext set up yet?
+
+nmeaDispatchEntry nmeaDispatch[NMEADISPATCHSIZE];	// Address to decoder lookup, empty if decoder is NULL
+CSLBool nmeaDispatchReady = FALSE;			// Built in decoders registered yet?
+nmeaUartBuffers nmeaUartInput;				// Filled by uartHwi, framed in place by processNmea()
+#ifdef NMEA_HOST
+Uns nmeaHostSwiPosts = 0;					// See nmea_host.h
+Uns nmeaHostSemPosts = 0;
+pthread_once_t nmeaDispatchOnce = PTHREAD_ONCE_INIT;	// Guards nmeaRegisterDefaults()
+#endif
 
 /*
  * Routines
@@ -67,97 +199,163 @@ nmeaGeographicPosition geographicPos;		// Structure holding out position & time
 // Note - this is a SWI function
 void processNmea(void)
 {
-//	Uint16 nmeaBuffer[NMEABUFFSIZE];		// Storage for NMEA message
 	Uint16 uartCount;						// Count how much data came out of UART
+	Uint16 published;						// How many messages we framed for decodeNmea()
+
+	// First time through, set up the board's receiver. A zeroed context
+	// would decode no talkers and have an empty sky index pointing at
+	// slot 0
+	if (!nmeaDefaultReady)
+	{
+		nmeaInitContext(&nmeaDefaultContext);
+		nmeaSubscribe(&nmeaDefaultContext, NMEA_EVENT_POSITION, nmeaLocationCheck, NULL);
+		nmeaDefaultReady = TRUE;
+	}
 
+	published = 0;
 
-	static CSLBool foundDollar = FALSE;		// Holds if dollar start symbol was found
-	static CSLBool foundStar = FALSE;		// Holds if star end symbol was found
-	static Uint16 nmeaChecksum = 0;			// NMEA Checksum
-	static Uint16 nmeaChkSum = 0;			// Actual Checksum
-	static Uint16 nmeaChkSumChars = 0;		// Counts how many bytes after '*' symbol
-	static Uint16 storeChksum = 0;			// Holds storage point for checksum correct/incorrect flag in nmeaBuffer
-//	static Uint16 count = 0;
-	static Uint16 nmeaDataIn = 0;			// Pointer to circ buffer input
+	// Frame each buffer uartHwi has handed over where it lies, then hand
+	// it back (see nmeaUartBuffers)
+	while ((uartCount = nmeaUartInput.count[nmeaUartInput.drain]) != 0)
+	{
+		NMEA_ACQUIRE();
+		published += nmeaProcessContext(&nmeaDefaultContext, nmeaUartInput.data[nmeaUartInput.drain], uartCount);
+		NMEA_RELEASE();
 
-/*
-	CSLBool foundDollar = FALSE;		// Holds if dollar start symbol was found
-	CSLBool foundStar = FALSE;		// Holds if star end symbol was found
-	Uint16 nmeaPointer = 0;			// Points to next empty space in nmeaBuffer
-	Uint16 nmeaChecksum = 0;			// NMEA Checksum
-	Uint16 nmeaChkSum = 0;			// Actual Checksum
-	Uint16 nmeaChkSumChars = 0;		// Counts how many bytes after '*' symbol
-	Uint16 storeChksum = 0;			// Holds storage point for checksum correct/incorrect flag
-*/
+		nmeaUartInput.count[nmeaUartInput.drain] = 0;
+		nmeaUartInput.drain ^= 1;
+	}
+
+	// Now post the decode SWI if we framed anything for it
+	if (published != 0)
+	{
+		SWI_post(&decodeNmeaSwi);
+	}
+}
+
+/*----------------------------------------------------------------------------
+ UART input, the HWI's side, see nmea_dec.h
+----------------------------------------------------------------------------*/
+nmeaChar * nmeaUartFillBuffer(nmeaUartBuffers * input)
+{
+	// processNmea() hasn't got round to it yet
+	if (input->count[input->fill] != 0)
+	{
+		input->dropped++;
+		return NULL;
+	}
+
+	NMEA_ACQUIRE();
+	return input->data[input->fill];
+}
+
+void nmeaUartHandOver(nmeaUartBuffers * input, Uint16 count)
+{
+	// Nothing to hand over, or the buffer is still processNmea()'s
+	// because nmeaUartFillBuffer() gave out NULL for it
+	if (count == 0 || input->count[input->fill] != 0)
+	{
+		return;
+	}
+
+	// The chars must be there before processNmea() sees the count
+	NMEA_RELEASE();
+	input->count[input->fill] = count;
+	input->fill ^= 1;
+}
+
+// Note - this is a SWI function
+void decodeNmea(void)
+{
+	// Subscribers hear about what was decoded as it is decoded
+	nmeaDecodeContext(&nmeaDefaultContext);
+}
+
+// Let anyone waiting for a position know there is a new one
+void nmeaLocationCheck(Uint16 event, const void * record, void * arg)
+{
+	if (((const nmeaGeographicPosition *)record)->status == NMEA_GPGLL_VALID)
+	{
+		SEM_postBinary(&locationCheckSem);
+	}
+}
+
+void nmeaInitContext(nmeaContext * context)
+{
+	// Everything starts off as zero, i.e. looking for a '$' with an
+	// empty queue and nothing decoded yet
+	memset(context, 0, sizeof(nmeaContext));
+
+	// Decode every talker and sentence until told otherwise
+	context->talkerMask = NMEA_TALKER_ALL;
+	context->pollMask = NMEA_EVENT_ALL;
+	context->epochStage.time = NMEA_EPOCH_NOTIME;
+
+	nmeaSkyInit(&context->sky);
+
+	// Make sure the decoders in this file are in the lookup table
+	nmeaDispatchSetUp();
+}
 
+Uint16 nmeaProcessContext(nmeaContext * context, const nmeaChar * data, Uint16 count)
+{
 	Uint16 i;								// Standard counter variable
-	Uint16 tempBuffer[UARTBUFFSIZE];		// Bug fix
-
-	// Set uartCount to zero
-//	uartCount = 0;
-	
-	// Find out how many bytes get!
-	uartCount = SWI_getmbox();
-	
-	// Note: uartCount now holds how many bytes we read!!!
-//	LOG_printf(&logNmea, "NMEA has %d bytes" , uartCount);
-
-//	count++;
-//	if (count == 2)
-//	{
-//		LOG_printf(&logNmea, "NMEA second round");
-//	}
-
-	// Temp bug fix because the uartDataBuffer var as a global was
-	// not being clearly displayed in CCS3.2
-	for (i=0; i < uartCount; i++)
-	{
-		tempBuffer[i] = uartDataBuffer[i];
-	}
-	
-	// Now a nice loop in which we copy the data across to the nmeaBuffer
-	// and check the checksum etc.
-	// All flags are static as a GPS message may lie across many UART buffers
-	for (i = 0; i < uartCount; i++)
+	Uint16 published;						// How many good messages we queued
+	nmeaSentenceView * framing;				// Entry we are filling in for this message
+
+	published = 0;
+
+	// Now a nice loop in which we copy the data across to the context's
+	// buffer and check the checksum etc.
+	// All flags live in the context as a GPS message may lie across many
+	// UART buffers. Each stage below moves i on past what it used, so the
+	// char after a checksum is looked at again for the next '$'
+	for (i = 0; i < count; )
 	{
 		// Search for the $ symbol if we don't already have it
 		// and if we also haven't found the '*' yet
 		// from a previous buffer load
-		if (!foundDollar & !foundStar)
+		if (!context->foundDollar & !context->foundStar)
 		{
-			// Set counter to zero
-	//		uartCount = 0;
 			// Make sure we don't overrun the amount of data we read
-			while (i < uartCount)
+			while (i < count)
 			{
-				// If we find the '$', set the flag
-				if (tempBuffer[i] == A_DOLLAR)
+				// If we find the '$', set the flag (as long as there is
+				// somewhere to put the message)
+				if (data[i] == A_DOLLAR && nmeaQueueClaim(&context->queue) == NULL)
+				{
+					// decodeNmea() hasn't caught up, drop this one
+					context->queue.overruns++;
+					i++;
+				}
+				else if (data[i] == A_DOLLAR)
 				{
 					i++;
 					// Set the foundDollar flag
-					foundDollar = TRUE;
+					context->foundDollar = TRUE;
 					// Clear the foundStar flag
-					foundStar = FALSE;
+					context->foundStar = FALSE;
 					// Clear the checksum variable (calculated)
-					nmeaChecksum = 0;
-					// Reset the nmeaChkSumChars counter
-					nmeaChkSumChars = 0;
+					context->checksum = 0;
+					// Reset the chkSumChars counter
+					context->chkSumChars = 0;
 					// Clear the checksum variable (from NMEA string)
-					nmeaChkSum = 0;
-					// Save a space at start of NMEA string for
-					// our checksum correct flag
-					storeChksum = nmeaDataIn;
-					nmeaDataIn++;
-					// Check nmeaDataIn for circ buff loop
-					if (nmeaDataIn == NMEABUFFSIZE)
-					{
-						nmeaDataIn = 0;
-					}
+					context->chkSum = 0;
+					// Note where the message starts, the checksum flag
+					// is kept in the queue entry rather than in the text
+					context->sentenceStart = context->queue.dataHead;
+					context->length = 0;
+					// Field 0 (the address) starts straight away
+					framing = nmeaQueueClaim(&context->queue);
+					framing->text = context->buffer;
+					framing->fieldCount = 1;
+					framing->field[0] = 0;
 					break;
 				}
 				// Otherwise just increment the counter
 				else
 				{
+					context->stats.discarded++;
 					i++;
 				}
 			}
@@ -165,32 +363,87 @@ void processNmea(void)
 		
 		// If we have found the '$', but not the '*' yet,
 		// start to put message in Circular NMEA buffer
-		if (foundDollar & !foundStar)
+		if (context->foundDollar & !context->foundStar)
 		{
+			// We made sure there was an entry when we found the '$'
+			framing = nmeaQueueClaim(&context->queue);
+
 			// Make sure we don't overrun the buffer
-			while (i < uartCount)
+			while (i < count)
 			{
+				// A '$' part way through means we lost the end of the last
+				// message, so start again from here
+				if (data[i] == A_DOLLAR)
+				{
+					context->queue.dataHead = context->sentenceStart;
+					context->checksum = 0;
+					context->length = 0;
+					framing->fieldCount = 1;
+					i++;
+				}
+				// Too long for a real message (no '*' seen), drop it and
+				// look for the next '$'
+				else if (context->length >= NMEA_MAXLENGTH && data[i] != A_STAR)
+				{
+					context->queue.dataHead = context->sentenceStart;
+					context->stats.overLong++;
+					context->foundDollar = FALSE;
+					break;
+				}
+				// Don't overwrite text decodeNmea() is still using,
+				// drop this message instead
+				else if (!nmeaQueueHasRoom(&context->queue, context->queue.dataHead))
+				{
+					context->queue.dataHead = context->sentenceStart;
+					context->queue.overruns++;
+					context->foundDollar = FALSE;
+					break;
+				}
 				// Look for the '*' for the end
-				if (tempBuffer[i] != A_STAR)
+				else if (data[i] != A_STAR)
 				{
+					// Note where each field starts while we are here, so the
+					// decoders can go straight to the field they want
+					if (data[i] == A_COMMA)
+					{
+						// Beyond NMEA_MAXFIELDS we only count them
+						if (framing->fieldCount <= NMEA_MAXFIELDS)
+						{
+							framing->field[framing->fieldCount] = context->length + 1;
+						}
+						framing->fieldCount++;
+					}
 					// Not the '*' end symbol, so copy this byte
-					nmeaBuffer[nmeaDataIn] = tempBuffer[i];
+					// (dataHead runs freely, mask for circ buff loop)
+					context->buffer[context->queue.dataHead & (NMEABUFFSIZE - 1)] = data[i];
 					// Calculate the new checksum value (XOR)
-					nmeaChecksum ^= nmeaBuffer[nmeaDataIn];
+					context->checksum ^= data[i];
 					// Increment our counters
 					i++;
-					nmeaDataIn++;
-					// Check nmeaDataIn for circ buff loop
-					if (nmeaDataIn == NMEABUFFSIZE)
+					context->length++;
+					context->queue.dataHead++;
+
+					// With an accept list, drop what isn't on it as soon as
+					// the address is in, and look for the next '$'
+					if (context->length == 5 && context->acceptCount != 0 && !nmeaAccepted(context))
 					{
-						nmeaDataIn = 0;
+						context->queue.dataHead = context->sentenceStart;
+						context->stats.filtered++;
+						context->foundDollar = FALSE;
+						break;
 					}
 				}
 				// Otherwise we found the star!
 				else
 				{
+					// Close off the last field (unless there were more than
+					// we index, where it is already closed)
+					if (framing->fieldCount <= NMEA_MAXFIELDS)
+					{
+						framing->field[framing->fieldCount] = context->length + 1;
+					}
 					// Set the found star flag
-					foundStar = TRUE;
+					context->foundStar = TRUE;
 					// Increment counter
 					i++;
 
@@ -201,80 +454,59 @@ void processNmea(void)
 		
 		// If we found the '$' and the '*' we need to read the last
 		// two bytes and compare the checksum
-		if (foundDollar && foundStar)
+		if (context->foundDollar && context->foundStar)
 		{
+			framing = nmeaQueueClaim(&context->queue);
+
 			// Make sure we don't overrun the buffer
-			while (i < uartCount)
+			while (i < count)
 			{
 				// Shift the last nibble left
-				nmeaChkSum <<= 4;
+				context->chkSum <<= 4;
 
 				// The following code converts the ASCII to HEX
-				nmeaChkSum += asciiToHex(tempBuffer[i]);
+				context->chkSum += asciiToHex(data[i]);
 
 				// Now note how many checksum ASCII chars we have acquired so far
-				nmeaChkSumChars ++;
+				context->chkSumChars ++;
 
 				// Increment counter too
 				i ++;
 
 				// If we got both check sum values figure out if the
 				// checksum is correct
-				if (nmeaChkSumChars == 2)
+				if (context->chkSumChars == 2)
 				{
-					if (nmeaChecksum == nmeaChkSum)
-					{
-						nmeaBuffer[storeChksum] = A_STAR;
+					// Record where the message sits and how long it is, this
+					// replaces the in-band flag and ETX markers
+					framing->start = context->sentenceStart;
+					framing->readable = NMEABUFFSIZE - (context->sentenceStart & (NMEABUFFSIZE - 1));
+					framing->length = context->length;
 
-						// Also put an end marker just in case there is no next nmeaMessage
-						// and therefore no '*' to look for (ETX = End Of Text)
-						nmeaBuffer[nmeaDataIn] = A_ETX;
-						nmeaDataIn++;
-
-						// Check nmeaDataIn for circ buff loop
-						if (nmeaDataIn == NMEABUFFSIZE)
-						{
-							nmeaDataIn = 0;
-						}
+					if (context->checksum == context->chkSum)
+					{
+						framing->status = NMEA_SENTENCE_GOOD;
+						nmeaQueuePublish(&context->queue);
 
 						// Now clear our flags
-						foundDollar = FALSE;
-						foundStar = FALSE;
+						context->foundDollar = FALSE;
+						context->foundStar = FALSE;
 
-						// Temp code to test NMEA decode output
-//						nmeaDataIn = 0;
-
-//						LOG_printf(&logNmea, "ChkSum GOOD - Posting SWI");
-
-						// Now post the SWI and any old number - it isn't important
-//						SWI_or(&decodeNmeaSwi, 0xFF);
-						SWI_post(&decodeNmeaSwi);
+						// Count it, so the caller knows to run the decoder
+						published++;
 
 						break;
 					}
 					else
 					{
-						nmeaBuffer[storeChksum] = A_STAR | 0xFF00;
-
-						// Also put an end marker just in case there is no next nmeaMessage
-						// and therefore no '*' to look for (ETX = End Of Text)
-						nmeaBuffer[nmeaDataIn] = A_ETX;
-						nmeaDataIn++;
-
-						// Check nmeaDataIn for circ buff loop
-						if (nmeaDataIn == NMEABUFFSIZE)
-						{
-							nmeaDataIn = 0;
-						}
+						framing->status = NMEA_SENTENCE_BADCHKSUM;
+						nmeaQueuePublish(&context->queue);
 
 						// Now clear our flags
-						foundDollar = FALSE;
-						foundStar = FALSE;
+						context->foundDollar = FALSE;
+						context->foundStar = FALSE;
 
-						// Temp code to test NMEA decode output
-//						nmeaDataIn = 0;
-
-						LOG_printf(&logNmea, "<< ChkSum BAD : Exp %x, Got %x >>", nmeaChkSum, nmeaChecksum);
+						NMEA_TRACE(context, NMEA_TRACE_FRAMER, NMEA_TRACE_CHECKSUM, context->chkSum, context->checksum, 0, 0);
 						break;
 					}
 				}
@@ -283,658 +515,2426 @@ void processNmea(void)
 		}
 		// Now find the next dollar and reset the flags etc.
 	}
+
+	return published;
 }
 
-void decodeNmea(void)
+/*----------------------------------------------------------------------------
+ Accept list, see nmea_dec.h
+----------------------------------------------------------------------------*/
+CSLBool nmeaAccept(nmeaContext * context, Uint32 address)
 {
-//	static	Uint16 nmeaDataOut = 0;			// Pointer to circ buffer output
-//	Uint16 nmeaDataOut;					// Pointer to circ buffer output
-//	CSLBool checksumGood = FALSE;			// FALSE until we checked it is true
-	Uint16	nmeaSentence;				// Holds sentence content, first prefix 'GP' and then the
-											// three letter postfix, or the module specific message
-//h	Uns oldST1;
-
-//	oldST1 = HWI_disable();
-
-	nmeaSentence = 0;
-//	nmeaDataOut = 0;
-	// Make a loop to work until we get to the end of the message (ETX marker)
-	do
-	{
-		// First check to see that we have a '*' and that it was a good checksum
-		if (nmeaBuffer[nmeaDataOut] != A_STAR)
-		{
-			LOG_printf(&logNmea, "<< Decoder - ChkSum BAD %c : %x >>", nmeaBuffer[nmeaDataOut], nmeaBuffer[nmeaDataOut]);
-
-			// If checksum was bad, roll to ETX
-			while (nmeaBuffer[nmeaDataOut] != A_ETX)
-			{
-				incDataPointer(&nmeaDataOut);
-			}
-
-			// Check to see if there is another sentence to decode
-			// Mask so we ignore if the checksum failed or not flag
-			if ((nmeaBuffer[nmeaDataOut + 1] & 0x00FF) == A_STAR)
-			{
-				// Increment the counter so we don't drop out of the do-while loop yet!
-				incDataPointer(&nmeaDataOut);
-			}
-
-			// If we got here, then nmeaBuffer[nmeaDataOut] == A_ETX, so the do-while
-			// loop is going to finish
-		}
-
-		// Now enter the next stage of decoding if there is a '*' and valid checksum
-		else
-		{
-//			LOG_printf(&logNmea, "Decoder - ChkSum GOOD");
-
-			// First, move past the '*' to the first character
-			incDataPointer(&nmeaDataOut);
-
-			// Now figure out if we start with 'GP' or not
-			nmeaSentence += nmeaBuffer[nmeaDataOut];
-			incDataPointer(&nmeaDataOut);
-			nmeaSentence <<= 8;
-			nmeaSentence += nmeaBuffer[nmeaDataOut];
-			incDataPointer(&nmeaDataOut);
-
-			// Check if it is 'GP'
-			if (nmeaSentence == NMEA_GP)
-			{
-				// Clear the nmeaSentence var so we can use it again
-				nmeaSentence = 0;
-
-				// Feed the three postfix chars into the variable
-				nmeaSentence += nmeaBuffer[nmeaDataOut];
-				incDataPointer(&nmeaDataOut);
-				nmeaSentence += nmeaBuffer[nmeaDataOut];
-				incDataPointer(&nmeaDataOut);
-				nmeaSentence += nmeaBuffer[nmeaDataOut];
-				incDataPointer(&nmeaDataOut);
-				
-				// Now decode the message based upon this data
-
- 				switch (nmeaSentence)
-				{
-				// GSV - Satellites in view
-				case NMEA_GPGSV:
-					LOG_printf(&logNmea, "GPGSV Sentence");
-					GPGSV_decode();
-					break;
-				
-				case NMEA_GPGLL:
-					LOG_printf(&logNmea, "GPGLL Sentence");
-					GPGLL_decode();
-					if (geographicPos.status == NMEA_GPGLL_VALID)
-					{
-						SEM_postBinary(&locationCheckSem);
-					}
-					break;
-				// next case
-
-				default:
-					// Go to end of this sentence
-					while (nmeaBuffer[nmeaDataOut] != A_ETX)
-					{
-						incDataPointer(&nmeaDataOut);
-					}
-//					incDataPointer(&nmeaDataOut);
-					LOG_printf(&logNmea, "<< NMEA Sentence not recognised >>");
-
-				} // END OF SWITCH STATEMENT
-
-			} // END OF IF GP SENTENCE
-			
-			// Handle here if not a 'GP' sentence (GPS module specific)
-			else
-			{
-				// For now just skip the contents
-				while (nmeaBuffer[nmeaDataOut] != A_ETX)
-				{
-					incDataPointer(&nmeaDataOut);
-				}
-//					incDataPointer(&nmeaDataOut);
-				LOG_printf(&logNmea, "<< Not a GP sentence >>");
-			}
+	CSLBool added;
 
-		} // END OF ELSE NOT A STAR STATEMENT
+	added = FALSE;
 
-	} while (nmeaBuffer[nmeaDataOut] != A_ETX);
-
-	// Increment pointer to start of next message
-	incDataPointer(&nmeaDataOut);
-
-//	HWI_restore(oldST1);
-}
-
-Uint16 asciiToHex(Uint16 ascii)
-{
-	if (ascii >= '0' && ascii <= '9')
-	{
-		// Return the value minus ASCII '0'
-		return (ascii - '0');
-	}
-	else
+	// processNmea() reads the list, so change it with the SWIs held off
+	SWI_disable();
+	if (context->acceptCount < NMEA_ACCEPTSIZE)
 	{
-		// Return the value minus 0x37, which changes ASCII A to 0x0A etc.
-		return (ascii - 0x37);
+		context->accept[context->acceptCount] = address;
+		context->acceptCount++;
+		added = TRUE;
 	}
+	SWI_enable();
 
+	return added;
 }
 
-void incDataPointer(Uint16 * pointer)
+void nmeaAcceptAll(nmeaContext * context)
 {
-	(*pointer) ++;
-
-	if ((*pointer) > NMEABUFFSIZE)
-	{
-		(*pointer) = 0;
-	}
+	SWI_disable();
+	context->acceptCount = 0;
+	SWI_enable();
 }
 
-
-/*----------------------------------------------------------------------------
-
- GSV - Satellites in view
-
-These sentences describe the sky position of a UPS satellite in view.
-Typically they're shipped in a group of 2 or 3.
-
-          1 2 3 4 5 6 7     n
-         | | | | | | |     |
- $--GSV,x,x,x,x,x,x,x,...*hh<CR><LF>
-
- Field Number: 
-  1) total number of messages
-  2) message number
-  3) satellites in view
-  4) satellite number
-  5) elevation in degrees (0-90)
-  6) azimuth in degrees to true north (0-359)
-  7) SNR in dB (0-99)
-  more satellite infos like 4)-7)
-  n) checksum
-
-Example:
-    $GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74
-    $GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00*74
-    $GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D
-
-NOTE: We only support maximum 12 satellites - this is only for debug
-info anyway, we probably won't use this info for anything except to
-confirm that we can see satellites
-
-WARNING: Make use of the "satellitesInView" value. If it is less than 12,
-it is possible that the the last elements of the the sentences will be
-full of rubbish.
-e.g. if "satellites in view" is 10, then the 3rd message, last two elements
-could be filled with meaningless rubbish.
-----------------------------------------------------------------------------*/
-void GPGSV_decode(void)
+CSLBool nmeaAccepted(const nmeaContext * context)
 {
-	Uint16  nmeaTemp1;						// Temp var for use during decoding
-	Uint16  nmeaTemp2;						// Temp var for use during decoding
-	Uint16  nmeaCount;						// Counter for this function
-	Uint16 nmeaBufferLocal[NMEABUFFSIZE];			// Circular buffer to store messages
+	Uint32 address;
+	Uint16 nmeaValue;
 	Uint16 i;
 
-	for (i=0; i< NMEABUFFSIZE; i++)
+	// Pack the address as nmeaSentenceAddress() does, straight from the
+	// buffer as the view isn't filled in until the checksum
+	address = 0;
+	for (i = 0; i < 5; i++)
 	{
-		nmeaBufferLocal[i] = nmeaBuffer[i];
-	}
-	// Reset the counter so we count the data for
-	// each sat into the array
-	nmeaCount = 0;
-
-	// Move pointer past the comma we are pointing to
-	incDataPointer(&nmeaDataOut);
+		nmeaValue = context->buffer[(context->sentenceStart + i) & (NMEABUFFSIZE - 1)];
+		if (nmeaValue < 0x20 || nmeaValue > 0x5F)
+		{
+			return FALSE;
+		}
 
-	// Read out the number of messages (total)
-	while (nmeaBufferLocal[nmeaDataOut] != A_COMMA)
-	{
-		incDataPointer(&nmeaDataOut);
+		address <<= 6;
+		address |= NMEA_ADDRESS_CHAR(nmeaValue);
 	}
 
-	// Move pointer past the comma we are pointing to
-	incDataPointer(&nmeaDataOut);
-
-	// Read out message number
-	nmeaTemp1 = 0;
-	while (nmeaBufferLocal[nmeaDataOut] != A_COMMA)
-	{
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-	}
-	// Check to make sure that number is not greater than 3
-	if (nmeaTemp1 > 3)
+	for (i = 0; i < context->acceptCount; i++)
 	{
-		LOG_printf(&logNmea, "ERROR in NMEA GPGSV: Too many messages (total = %d)", nmeaTemp1);
-		return;
-	}
-	// Now subtract one and multiply by 4 to use this value 
-	// for accessing our array
-	nmeaTemp1 = (nmeaTemp1 - 1) * 4;
-
-	// Move pointer past the comma we are pointing to
-	incDataPointer(&nmeaDataOut);
-
-	// Find out number of visable satellites
-	// We use temp variable until we know the value
-	// as someone may be reading it. When we have the 
-	// complete value, then we copy, else someone may 
-	// read '0' by error, just 'cause we are in the 
-	// middle of figuring out the data
-	nmeaTemp2 = 0;
-	while (nmeaBufferLocal[nmeaDataOut] != A_COMMA)
-	{
-		nmeaTemp2 *= 10;
-		nmeaTemp2 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-	}
-	satellitesInView = nmeaTemp2;
-
-	// Work through the rest of the sentence 'till we get to 
-	// the end marker
-	while (nmeaBufferLocal[nmeaDataOut] != A_ETX)
-	{
-		// Move pointer past the comma we are pointing to
-		incDataPointer(&nmeaDataOut);
-		// Get the sat number
-		nmeaTemp2 = 0;
-		while(nmeaBufferLocal[nmeaDataOut] != A_COMMA)
-		{
-			nmeaTemp2 *= 10;
-			nmeaTemp2 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-			incDataPointer(&nmeaDataOut);
-		}
-		satsInView[nmeaTemp1].satelliteNumber = nmeaTemp2;
-		// Move pointer past the comma we are pointing to
-		incDataPointer(&nmeaDataOut);
-		// Get the sat elevation
-		nmeaTemp2 = 0;
-		while(nmeaBufferLocal[nmeaDataOut] != A_COMMA)
-		{
-			nmeaTemp2 *= 10;
-			nmeaTemp2 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-			incDataPointer(&nmeaDataOut);
-		}
-		satsInView[nmeaTemp1].elevation = nmeaTemp2;
-		// Move pointer past the comma we are pointing to
-		incDataPointer(&nmeaDataOut);
-		// Get the sat azimuth
-		nmeaTemp2 = 0;
-		while(nmeaBufferLocal[nmeaDataOut] != A_COMMA)
-		{
-			nmeaTemp2 *= 10;
-			nmeaTemp2 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-			incDataPointer(&nmeaDataOut);
-		}
-		satsInView[nmeaTemp1].azimuth = nmeaTemp2;
-		// Move pointer past the comma we are pointing to
-		incDataPointer(&nmeaDataOut);
-		// Get the sat SNR
-		nmeaTemp2 = 0;
-		// Note, sometimes no comma if there is no SNR at end of sentence
-		while(nmeaBufferLocal[nmeaDataOut] != A_COMMA &&
-				nmeaBufferLocal[nmeaDataOut] != A_ETX)
-		{
-			nmeaTemp2 *= 10;
-			nmeaTemp2 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-			incDataPointer(&nmeaDataOut);
-		}
-		satsInView[nmeaTemp1].signalNoiseRatio = nmeaTemp2;
-
-		// Increment nmeaTemp1
-		nmeaTemp1 ++;
-
-		// Now increment our counter
-		nmeaCount ++;
-		// Check it is not greater than 4
-		// no more than four sat's per sentence
-		// NOTE: Probably redundant
-		if (nmeaCount > 4)
+		if (context->accept[i] == address || context->accept[i] == (address & NMEA_FORMATTER_MASK))
 		{
-			break;
+			return TRUE;
 		}
-		// Now go round again and get the next sat stats!
 	}
-	// Move pointer past the A_ETX value we are pointing to
-//	incDataPointer(&nmeaDataOut);
 
-	// Actually, by the time we get here we should be pointing to 
-	// A_ETX. The calling function needs this marker to finish
-	// his do-while loop
-#ifdef OUTPUT_GPGSV_DATA
-	outputGPGSV();
-#endif
+	return FALSE;
 }
 
-/*----------------------------------------------------------------------------
+Uint16 nmeaDecodeContext(nmeaContext * context)
+{
+	nmeaSentenceView * sentence;		// Where the sentence sits in the context's buffer
+	Uint16 events;						// What the decoders found (NMEA_EVENT_xxx)
 
- GLL - Geographic Position - Latitude/Longitude
+	events = 0;
 
-          1       2 3        4 5         6 7   8
-         |       | |        | |         | |   |
- $--GLL,llll.ll,a,yyyyy.yy,a,hhmmss.ss,a,m,*hh<CR><LF>
+	// Make sure the decoders in this file are in the lookup table
+	nmeaDispatchSetUp();
 
- Field Number: 
-  1) Latitude
-  2) N or S (North or South)
-  3) Longitude
-  4) E or W (East or West)
-  5) Universal Time Coordinated (UTC)
-  6) Status A - Data Valid, V - Data Invalid
-  7) FAA mode indicator (NMEA 2.3 and later)
-  8) Checksum
+	// Work through every message nmeaProcessContext() has framed since we
+	// last ran. A SWI posted twice before it runs only runs once, so don't
+	// assume one message per post
+	while ((sentence = nmeaQueuePeek(&context->queue)) != NULL)
+	{
+		events |= nmeaDecodeSentence(context, sentence);
 
-Introduced in NMEA 3.0.
+		// Hand the entry and its text back to nmeaProcessContext()
+		nmeaQueueRelease(&context->queue);
+	}
+
+	return events;
+}
 
+void nmeaSnapshotStats(const nmeaContext * context, nmeaStats * stats)
+{
+	// The counters only change in the SWIs
+	SWI_disable();
+	*stats = context->stats;
+	stats->overruns = context->queue.overruns;
+	SWI_enable();
+}
+
+#ifdef NMEA_VERBOSE
+/*----------------------------------------------------------------------------
+ Formats what is in the context's trace rings to logNmea, oldest first,
+ and returns how many entries it formatted. Runs at a lower priority than
+ the SWIs that write the rings, so an entry is copied out and only used
+ if its writer hasn't come round and started on it again meanwhile.
 ----------------------------------------------------------------------------*/
-void GPGLL_decode(void)
+const char * const nmeaTraceFormat[NMEA_TRACE_EVENTS] = {
+	"<< ChkSum BAD : Exp %x, Got %x >>",
+	"<< Decoder - ChkSum BAD %c : %x >>",
+	"<< NMEA Sentence not recognised >>",
+	"GPGSV Sentence",
+	"ERROR in NMEA GPGSV: No message number",
+	"ERROR in NMEA GPGSV: Sky table full (%d, %d)",
+	"GPGLL Sentence",
+	"GPGGA Sentence",
+	"GPRMC Sentence",
+	"GPGSA Sentence",
+	"ERROR in NMEA GPGSA: unreadable satellite ID in field %d",
+	"GPVTG Sentence",
+	"GPZDA Sentence",
+	"GPGSV cycle dropped after %d of %d messages",
+	"<< Talker %c%c not decoded >>"
+};
+
+Uint16 nmeaDrainTrace(nmeaContext * context)
 {
-	Int32  nmeaTemp1;						// Temp var for use during decoding
-	Uint16  nmeaTemp2;						// Temp var for use during decoding
-	Uint16  nmeaCount;						// Counter for this function
-	Uint16 nmeaBufferLocal[NMEABUFFSIZE];	// Circular buffer to store messages
-	Uint16 i;
+	nmeaTraceRing * ring;
+	nmeaTraceEntry entry;
+	Uint16 formatted;
+	Uint16 side;
+	Uint16 next;							// Ring with the oldest entry
+	Uint16 waiting;
 
-//	nmeaGeographicPosition geographicPos;		// Structure holding out position & time (GPGLL)
+	formatted = 0;
 
-	for (i=0; i< NMEABUFFSIZE; i++)
+	for (;;)
 	{
-		nmeaBufferLocal[i] = nmeaBuffer[i];
-	}
-	// Reset the counter so we count the data for
-	// each sat into the array
-	nmeaCount = 0;
+		// Catch up with anything that was overwritten, then take the
+		// older of the two rings' next entries
+		next = 2;
+		for (side = 0; side < 2; side++)
+		{
+			ring = &context->trace[side];
+			waiting = (Uint16)(ring->head - ring->tail);
+			if (waiting > NMEA_TRACE_SIZE)
+			{
+				ring->lost += waiting - NMEA_TRACE_SIZE;
+				ring->tail = ring->head - NMEA_TRACE_SIZE;
+				waiting = NMEA_TRACE_SIZE;
+			}
 
-	// Move pointer past the comma we are pointing to
-	incDataPointer(&nmeaDataOut);
+			if (waiting != 0 && (next == 2 ||
+				(Int32)(ring->entry[ring->tail & (NMEA_TRACE_SIZE - 1)].time -
+						context->trace[next].entry[context->trace[next].tail & (NMEA_TRACE_SIZE - 1)].time) < 0))
+			{
+				next = side;
+			}
+		}
 
-	// Read out the latitude Degrees
-	nmeaTemp1 = 0;
-	{
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-	}
+		if (next == 2)
+		{
+			break;
+		}
 
-	// Now store value
-	geographicPos.latitude.gpsDegrees = nmeaTemp1;
-	
-	// Read out the latitude Minutes
-	nmeaTemp1 = 0;
-	while (nmeaBufferLocal[nmeaDataOut] != A_FULLSTOP)
-	{
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-	}
+		ring = &context->trace[next];
+		NMEA_ACQUIRE();
+		entry = ring->entry[ring->tail & (NMEA_TRACE_SIZE - 1)];
+		NMEA_ACQUIRE();
 
-	// Now store value
-	geographicPos.latitude.gpsMinutes = nmeaTemp1;
-	
-	// Move pointer past the decimal point we are pointing to
-	incDataPointer(&nmeaDataOut);
+		// The writer may have come round to it while we copied it. With the
+		// ring full we can't tell if it has started on this one, so that
+		// counts as lost too
+		if ((Uint16)(ring->head - ring->tail) >= NMEA_TRACE_SIZE)
+		{
+			ring->lost++;
+			ring->tail++;
+			continue;
+		}
+		ring->tail++;
 
-	// Read out the latitude MMMM after decimal point (max. four chars)
-	nmeaCount = 0;
-	nmeaTemp1 = 0;
-	while (nmeaBufferLocal[nmeaDataOut] != A_COMMA)
-	{
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		nmeaCount ++;
-		// Make sure we only read maximum four values of precision
-		if (nmeaCount > NMEA_GPGLL_PRECISION)
+		if (entry.event < NMEA_TRACE_EVENTS)
 		{
-			// Loop round until we find the comma
-			while (nmeaBufferLocal[nmeaDataOut] != A_COMMA)
-			{
-				incDataPointer(&nmeaDataOut);
-			}
+			LOG_printf(&logNmea, nmeaTraceFormat[entry.event], entry.arg[0], entry.arg[1]);
+			formatted++;
 		}
 	}
 
-	// Now check that there were four values of precision to read
-	if (nmeaCount < NMEA_GPGLL_PRECISION)
+	for (side = 0; side < 2; side++)
 	{
-		// This increases value in nmeaTemp1 by 10, 100, 1000 etc. if necessary
-		// to make up for lost precision
-		for (nmeaTemp2 = 0; nmeaTemp2 < (NMEA_GPGLL_PRECISION - nmeaCount); nmeaTemp2++)
+		if (context->trace[side].lost != 0)
 		{
-			nmeaTemp1 *= 10;
+			LOG_printf(&logNmea, "<< Trace lost %d entries >>", (Uint16)context->trace[side].lost);
+			context->trace[side].lost = 0;
 		}
 	}
-	
-	// Now store value
-	geographicPos.latitude.gpsSubMinutes = nmeaTemp1;
 
-	// Move pointer past the comma we are pointing to
-	incDataPointer(&nmeaDataOut);
+	return formatted;
+}
+#endif
 
-	// Check for S latitude for sign change
-	if (nmeaBufferLocal[nmeaDataOut] == A_S || \
-		nmeaBufferLocal[nmeaDataOut] == A_s)
+Uint16 nmeaDecodeSentence(nmeaContext * context, const nmeaSentenceView * sentence)
+{
+	const nmeaDispatchEntry * entry;	// Decoder registered for the sentence address
+	Uint32 address;						// Full five character address
+	Uint16 constellation;				// Who the talker is
+	Uint16 events;						// What the decoder found (NMEA_EVENT_xxx)
+	Uint16 counted;						// Events still to count
+	Uint16 wanted;						// Events someone polls or subscribes to
+	Uint16 bit;
+
+	// First check that it was a good checksum
+	if (sentence->status != NMEA_SENTENCE_GOOD)
 	{
-		geographicPos.latitude.gpsDegrees *= -1;
+		context->stats.checksumErrors++;
+		NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_BADSENTENCE, nmeaViewChar(sentence, 0), sentence->status, 0, 0);
+		return 0;
 	}
 
-	// Move pointer past the N/S letter we are pointing to
-	incDataPointer(&nmeaDataOut);
-	
-	// Move pointer past the comma we are pointing to
-	incDataPointer(&nmeaDataOut);
+	context->sentences++;
 
-	// Read out the longitude DDD
-	nmeaTemp1 = 0;
+	// Drop talkers we have been told to ignore before looking any further
+	address = nmeaSentenceAddress(sentence);
+	constellation = nmeaAddressConstellation(address);
+	if ((context->talkerMask & NMEA_TALKER_MASK(constellation)) == 0)
 	{
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
+		context->stats.talkerDrops++;
+		NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_TALKER, nmeaViewChar(sentence, 0), nmeaViewChar(sentence, 1), 0, 0);
+		return 0;
 	}
 
-	// Now store value
-	geographicPos.longitude.gpsDegrees = nmeaTemp1;
+	// Now find the decoder for the full five character address, or the
+	// one for this sentence from any talker
+	entry = nmeaFindEntry(address);
 
-	// Read out the longitude MM
-	nmeaTemp1 = 0;
-	while (nmeaBufferLocal[nmeaDataOut] != A_FULLSTOP)
+	if (entry == NULL)
 	{
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
+		// For now just skip the contents
+		context->stats.unknownSentences++;
+		NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_UNKNOWN, 0, 0, 0, 0);
+		return 0;
 	}
 
-	// Now store value
-	geographicPos.longitude.gpsMinutes = nmeaTemp1;
+	// Nobody polls or subscribes to what it would give us, so don't
+	// bother reading any of its fields
+	wanted = context->pollMask | context->subscribed;
+	if (wanted & NMEA_EVENT_EPOCH)
+	{
+		wanted |= NMEA_EPOCH_SOURCES;
+	}
 
-	// Move pointer past the decimal point we are pointing to
-	incDataPointer(&nmeaDataOut);
+	if ((entry->events & wanted) == 0)
+	{
+		context->stats.unsubscribed++;
+		return 0;
+	}
 
-	// Read out the longitude MMMM after decimal point (max. four chars)
-	nmeaCount = 0;
-	nmeaTemp1 = 0;
-	while (nmeaBufferLocal[nmeaDataOut] != A_COMMA)
+	// Readers must see the records it may write as changing until it is
+	// done with them, see nmeaReadRecord(). Only the records it reports
+	// were written, the numbers of the others go back to what they were
+	context->constellation = constellation;
+	nmeaSequenceStep(context, entry->events);
+	NMEA_RELEASE();
+	events = entry->decoder(context, sentence);
+	NMEA_RELEASE();
+	nmeaSequenceStep(context, events & entry->events);
+	nmeaSequenceBack(context, entry->events & ~events);
+
+	// Fold it into the epoch it belongs to, which may finish that epoch
+	if ((events & NMEA_EPOCH_SOURCES) && (wanted & NMEA_EVENT_EPOCH))
 	{
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		nmeaCount ++;
-		// Make sure we only read maximum four values of precision
-		if (nmeaCount > NMEA_GPGLL_PRECISION)
-		{
-			// Loop round until we find the comma
-			while (nmeaBufferLocal[nmeaDataOut] != A_COMMA)
-			{
-				incDataPointer(&nmeaDataOut);
-			}
-		}
+		events |= nmeaEpochAdd(context, events);
 	}
 
-	// Now check that there were four values of precision to read
-	if (nmeaCount < NMEA_GPGLL_PRECISION)
+	// Count it against each event its decoder reported, nearly always one
+	counted = events;
+	for (bit = 0; counted != 0 && bit < NMEA_STATS_TYPES; bit++, counted >>= 1)
 	{
-		// This increases value in nmeaTemp1 by 10, 100, 1000 etc. if necessary
-		// to make up for lost precision
-		for (nmeaTemp2 = 0; nmeaTemp2 < (NMEA_GPGLL_PRECISION - nmeaCount); nmeaTemp2++)
+		if (counted & 1)
 		{
-			nmeaTemp1 *= 10;
+			context->stats.decoded[bit]++;
 		}
 	}
 
-	// Now store value
-	geographicPos.longitude.gpsSubMinutes = nmeaTemp1;
-
-	// Move pointer past the comma we are pointing to
-	incDataPointer(&nmeaDataOut);
-
-	// Check for W longitude for sign change
-	if (nmeaBufferLocal[nmeaDataOut] == A_W || \
-		nmeaBufferLocal[nmeaDataOut] == A_w)
+	if (events & context->subscribed)
 	{
-		geographicPos.longitude.gpsDegrees *= -1;
+		nmeaNotify(context, events);
 	}
 
-	// Move pointer past the E/W letter we are pointing to
-	incDataPointer(&nmeaDataOut);
-
-	// Move pointer past the comma we are pointing to
-	incDataPointer(&nmeaDataOut);
+	return events;
+}
 
-	// Read out the UTC HHMMSS
-	nmeaTemp1 = 0;
-	while (nmeaBufferLocal[nmeaDataOut] != A_FULLSTOP)
+/*----------------------------------------------------------------------------
+ Frames the next sentence in a block of text that is all in memory
+
+ This does the job of nmeaProcessContext() for text that doesn't arrive a
+ UART buffer at a time, e.g. a capture file. It keeps to the same rules
+ (restart on a '$', drop anything longer than NMEA_MAXLENGTH, look for
+ the next '$' straight after the checksum) and builds the same field
+ index and checksum status, but the view points straight at the text
+ instead of at a copy in a context's buffer. Only the accept list and
+ the queue's overruns are left to nmeaProcessContext(). nmea_check.c
+ runs the same text through both and compares what they frame.
+
+ Looks for a '$' from *position on. Returns TRUE with the view filled in
+ and *position just past the checksum. Returns FALSE if there is no
+ complete sentence left, with *position on the '$' of the incomplete one
+ at the end of the text (or at count if there isn't one).
+----------------------------------------------------------------------------*/
+CSLBool nmeaFrameText(const nmeaChar * data, Uint32 count, Uint32 * position, nmeaSentenceView * view)
+{
+	Uint32 i;								// Standard counter variable
+	Uint32 dollar;							// Where the current message's '$' is
+	Uint16 checksum;						// NMEA Checksum (calculated)
+	Uint16 length;							// How many chars of the message so far
+
+	i = *position;
+
+	while (i < count)
+	{
+		// Search for the $ symbol
+		while (i < count && data[i] != A_DOLLAR)
+		{
+			i++;
+		}
+		if (i == count)
+		{
+			break;
+		}
+
+		dollar = i;
+		i++;
+
+		view->text = &data[i];
+		view->start = 0;
+		view->readable = (count - i > 0xFFFF) ? 0xFFFF : (Uint16)(count - i);
+		view->fieldCount = 1;
+		view->field[0] = 0;
+		checksum = 0;
+		length = 0;
+
+		// Index the fields and work out the checksum up to the '*'
+		while (i < count && data[i] != A_STAR && data[i] != A_DOLLAR && length < NMEA_MAXLENGTH)
+		{
+			if (data[i] == A_COMMA)
+			{
+				// Beyond NMEA_MAXFIELDS we only count them
+				if (view->fieldCount <= NMEA_MAXFIELDS)
+				{
+					view->field[view->fieldCount] = length + 1;
+				}
+				view->fieldCount++;
+			}
+			checksum ^= data[i];
+			length++;
+			i++;
+		}
+
+		// Need the '*' and both checksum chars, else the text ends part
+		// way through this message
+		if (i + 2 >= count && (i == count || data[i] == A_STAR))
+		{
+			*position = dollar;
+			return FALSE;
+		}
+
+		// Lost the end of the message (a new '$') or it was too long, go
+		// round again from here
+		if (data[i] != A_STAR)
+		{
+			continue;
+		}
+
+		// Close off the last field (unless there were more than we
+		// index, where it is already closed)
+		if (view->fieldCount <= NMEA_MAXFIELDS)
+		{
+			view->field[view->fieldCount] = length + 1;
+		}
+		view->length = length;
+
+		if (checksum == ((asciiToHex(data[i + 1]) << 4) + asciiToHex(data[i + 2])))
+		{
+			view->status = NMEA_SENTENCE_GOOD;
+		}
+		else
+		{
+			view->status = NMEA_SENTENCE_BADCHKSUM;
+		}
+
+		*position = i + 3;
+		return TRUE;
+	}
+
+	*position = count;
+	return FALSE;
+}
+
+/*----------------------------------------------------------------------------
+ Sentence queue (see nmea_dec.h)
+
+ Claim/HasRoom/Publish are only called by the producer, Peek/Release only
+ by the consumer.
+----------------------------------------------------------------------------*/
+nmeaSentenceView * nmeaQueueClaim(nmeaSentenceQueue * queue)
+{
+	// Full when the producer is a whole queue ahead
+	if ((Uint16)(queue->head - queue->tail) >= NMEASENTBUFFSIZE)
+	{
+		return NULL;
+	}
+
+	// Don't let our writes to the entry move ahead of seeing it free
+	NMEA_ACQUIRE();
+
+	return &queue->entry[queue->head & (NMEASENTBUFFSIZE - 1)];
+}
+
+CSLBool nmeaQueueHasRoom(nmeaSentenceQueue * queue, Uint16 dataIn)
+{
+	// Room while we are less than a whole buffer ahead of the consumer
+	if ((Uint16)(dataIn - queue->dataTail) >= NMEABUFFSIZE)
+	{
+		return FALSE;
+	}
+
+	NMEA_ACQUIRE();
+
+	return TRUE;
+}
+
+void nmeaQueuePublish(nmeaSentenceQueue * queue)
+{
+	// The entry and its text must be visible before the new head
+	NMEA_RELEASE();
+
+	queue->head++;
+}
+
+nmeaSentenceView * nmeaQueuePeek(nmeaSentenceQueue * queue)
+{
+	if (queue->tail == queue->head)
+	{
+		return NULL;
+	}
+
+	// Don't read the entry until we have seen the head that published it
+	NMEA_ACQUIRE();
+
+	return &queue->entry[queue->tail & (NMEASENTBUFFSIZE - 1)];
+}
+
+void nmeaQueueRelease(nmeaSentenceQueue * queue)
+{
+	nmeaSentenceView * sentence = &queue->entry[queue->tail & (NMEASENTBUFFSIZE - 1)];
+	Uint16 dataTail = sentence->start + sentence->length;
+
+	// Finish reading the entry and its text before handing them back
+	NMEA_RELEASE();
+
+	queue->dataTail = dataTail;
+	queue->tail++;
+}
+
+Uint32 nmeaSentenceAddress(const nmeaSentenceView * sentence)
+{
+	Uint32 address;
+	Uint16 nmeaValue;
+	Uint16 i;
+
+	address = 0;
+
+	for (i = 0; i < 5; i++)
+	{
+		nmeaValue = nmeaViewChar(sentence, i);
+
+		// Only ' ' to '_' have a code of their own, this also catches
+		// a sentence that is too short (ETX)
+		if (nmeaValue < 0x20 || nmeaValue > 0x5F)
+		{
+			return NMEA_ADDRESS_INVALID;
+		}
+
+		address <<= 6;
+		address |= NMEA_ADDRESS_CHAR(nmeaValue);
+	}
+
+	return address;
+}
+
+/*----------------------------------------------------------------------------
+ Works out the constellation from the two talker chars of an address
+----------------------------------------------------------------------------*/
+Uint16 nmeaAddressConstellation(Uint32 address)
+{
+	Uint16 talker;
+
+	if (address == NMEA_ADDRESS_INVALID)
+	{
+		return NMEA_CONSTELLATION_OTHER;
+	}
+
+	// Unpack the two talker chars back into the NMEA_GP etc. form
+	talker = (Uint16)((((address >> 24) & 0x3F) + 0x20) << 8) | (Uint16)(((address >> 18) & 0x3F) + 0x20);
+
+	switch (talker)
+	{
+		case NMEA_GP:
+			return NMEA_CONSTELLATION_GPS;
+		case NMEA_GL:
+			return NMEA_CONSTELLATION_GLONASS;
+		case NMEA_GA:
+			return NMEA_CONSTELLATION_GALILEO;
+		case NMEA_GB:
+		case NMEA_BD:
+			return NMEA_CONSTELLATION_BEIDOU;
+		case NMEA_QZ:
+			return NMEA_CONSTELLATION_QZSS;
+		case NMEA_GN:
+			return NMEA_CONSTELLATION_MULTI;
+		default:
+			return NMEA_CONSTELLATION_OTHER;
+	}
+}
+
+Uint16 nmeaDispatchHash(Uint32 address)
+{
+	// Multiplicative hash, the top bits of the product are well mixed
+	return (Uint16)((Uint32)(address * 0x9E3779B1UL) >> 26) & (NMEADISPATCHSIZE - 1);
+}
+
+CSLBool nmeaRegisterDecoder(Uint32 address, nmeaDecoder decoder, Uint16 events)
+{
+	Uint16 slot;
+	Uint16 i;
+
+	if (address == NMEA_ADDRESS_INVALID || decoder == NULL)
+	{
+		return FALSE;
+	}
+
+	slot = nmeaDispatchHash(address);
+
+	// Linear probe for the address itself (replace) or an empty slot
+	for (i = 0; i < NMEADISPATCHSIZE; i++)
+	{
+		if (nmeaDispatch[slot].decoder == NULL || nmeaDispatch[slot].address == address)
+		{
+			// Set the address before the decoder, the decoder marks the slot used
+			nmeaDispatch[slot].address = address;
+			nmeaDispatch[slot].events = events;
+			nmeaDispatch[slot].decoder = decoder;
+			return TRUE;
+		}
+
+		slot = (slot + 1) & (NMEADISPATCHSIZE - 1);
+	}
+
+	// Table is full
+	return FALSE;
+}
+
+nmeaDecoder nmeaFindDecoder(Uint32 address)
+{
+	const nmeaDispatchEntry * entry;
+
+	entry = nmeaFindEntry(address);
+
+	return (entry != NULL) ? entry->decoder : NULL;
+}
+
+const nmeaDispatchEntry * nmeaFindEntry(Uint32 address)
+{
+	const nmeaDispatchEntry * entry;
+
+	// A decoder for this talker's sentence wins over one for any talker
+	entry = nmeaDispatchLookup(address);
+
+	if (entry == NULL && address != NMEA_ADDRESS_INVALID)
+	{
+		entry = nmeaDispatchLookup(address & NMEA_FORMATTER_MASK);
+	}
+
+	return entry;
+}
+
+const nmeaDispatchEntry * nmeaDispatchLookup(Uint32 address)
+{
+	Uint16 slot;
+	Uint16 i;
+
+	slot = nmeaDispatchHash(address);
+
+	// The table is kept at most half full, so this usually finds the
+	// address (or an empty slot) on the first probe
+	for (i = 0; i < NMEADISPATCHSIZE; i++)
+	{
+		if (nmeaDispatch[slot].decoder == NULL)
+		{
+			break;
+		}
+
+		if (nmeaDispatch[slot].address == address)
+		{
+			return &nmeaDispatch[slot];
+		}
+
+		slot = (slot + 1) & (NMEADISPATCHSIZE - 1);
+	}
+
+	return NULL;
+}
+
+void nmeaRegisterDefaults(void)
+{
+	// Every talker's version of these looks the same
+	nmeaRegisterDecoder(NMEA_FORMATTER('G','S','V'), GPGSV_decode, NMEA_EVENT_SATELLITES);
+	nmeaRegisterDecoder(NMEA_FORMATTER('G','L','L'), GPGLL_decode, NMEA_EVENT_POSITION);
+	nmeaRegisterDecoder(NMEA_FORMATTER('G','G','A'), GPGGA_decode, NMEA_EVENT_FIX);
+	nmeaRegisterDecoder(NMEA_FORMATTER('R','M','C'), GPRMC_decode, NMEA_EVENT_NAVIGATION);
+	nmeaRegisterDecoder(NMEA_FORMATTER('G','S','A'), GPGSA_decode, NMEA_EVENT_ACTIVE);
+	nmeaRegisterDecoder(NMEA_FORMATTER('V','T','G'), GPVTG_decode, NMEA_EVENT_VELOCITY);
+	nmeaRegisterDecoder(NMEA_FORMATTER('Z','D','A'), GPZDA_decode, NMEA_EVENT_TIME);
+
+	nmeaDispatchReady = TRUE;
+}
+
+void nmeaDispatchSetUp(void)
+{
+#ifdef NMEA_HOST
+	// Host threads can each be setting up a context of their own at the
+	// same time, so only one of them may fill in the table and the rest
+	// must wait until it has
+	pthread_once(&nmeaDispatchOnce, nmeaRegisterDefaults);
+#else
+	// On the board the first call is from processNmea(), and nothing
+	// decodes until it has posted decodeNmea()
+	if (!nmeaDispatchReady)
+	{
+		nmeaRegisterDefaults();
+	}
+#endif
+}
+
+/*----------------------------------------------------------------------------
+ Subscriptions, see nmea_dec.h
+----------------------------------------------------------------------------*/
+CSLBool nmeaSubscribe(nmeaContext * context, Uint16 events, nmeaSubscriber callback, void * arg)
+{
+	Uint16 i;
+	CSLBool added;
+
+	if (events == 0 || callback == NULL)
+	{
+		return FALSE;
+	}
+
+	added = FALSE;
+
+	// decodeNmea() walks the table, so change it with the SWIs held off
+	SWI_disable();
+	for (i = 0; i < NMEA_SUBSCRIBERS; i++)
+	{
+		if (context->subscription[i].callback == NULL)
+		{
+			context->subscription[i].events = events;
+			context->subscription[i].callback = callback;
+			context->subscription[i].arg = arg;
+			context->subscribed |= events;
+			added = TRUE;
+			break;
+		}
+	}
+	SWI_enable();
+
+	return added;
+}
+
+void nmeaUnsubscribe(nmeaContext * context, nmeaSubscriber callback, void * arg)
+{
+	Uint16 i;
+
+	SWI_disable();
+	context->subscribed = 0;
+	for (i = 0; i < NMEA_SUBSCRIBERS; i++)
+	{
+		if (context->subscription[i].callback == callback && context->subscription[i].arg == arg)
+		{
+			context->subscription[i].callback = NULL;
+			context->subscription[i].events = 0;
+		}
+
+		context->subscribed |= context->subscription[i].events;
+	}
+	SWI_enable();
+}
+
+const void * nmeaEventRecord(const nmeaContext * context, Uint16 event)
+{
+	switch (event)
+	{
+		case NMEA_EVENT_POSITION:
+			return &context->geographicPos;
+		case NMEA_EVENT_SATELLITES:
+			return &context->sky;
+		case NMEA_EVENT_FIX:
+			return &context->fixData;
+		case NMEA_EVENT_NAVIGATION:
+			return &context->navigationData;
+		case NMEA_EVENT_ACTIVE:
+			return &context->activeSats;
+		case NMEA_EVENT_VELOCITY:
+			return &context->velocity;
+		case NMEA_EVENT_TIME:
+			return &context->dateTime;
+		case NMEA_EVENT_EPOCH:
+			return &context->epoch;
+		default:
+			return NULL;
+	}
+}
+
+void nmeaNotify(nmeaContext * context, Uint16 events)
+{
+	Uint16 i;
+	Uint16 wanted;
+	Uint16 event;
+	nmeaSubscription * subscription;
+
+	for (i = 0; i < NMEA_SUBSCRIBERS; i++)
+	{
+		subscription = &context->subscription[i];
+		if (subscription->callback == NULL)
+		{
+			continue;
+		}
+
+		// One call for each event it asked for, lowest first
+		wanted = subscription->events & events;
+		while (wanted != 0)
+		{
+			event = wanted & (Uint16)(~wanted + 1);
+			subscription->callback(event, nmeaEventRecord(context, event), subscription->arg);
+			wanted &= ~event;
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ Snapshots, see nmea_dec.h
+----------------------------------------------------------------------------*/
+const Uint16 nmeaRecordSize[NMEA_STATS_TYPES] = {
+	sizeof(nmeaGeographicPosition),			// NMEA_EVENT_POSITION
+	sizeof(nmeaSkyTable),					// NMEA_EVENT_SATELLITES
+	sizeof(nmeaFixData),					// NMEA_EVENT_FIX
+	sizeof(nmeaNavigationData),				// NMEA_EVENT_NAVIGATION
+	sizeof(nmeaActiveSatellites),			// NMEA_EVENT_ACTIVE
+	sizeof(nmeaVelocityData),				// NMEA_EVENT_VELOCITY
+	sizeof(nmeaDateTime),					// NMEA_EVENT_TIME
+	sizeof(nmeaEpochFix)					// NMEA_EVENT_EPOCH
+};
+
+Uint16 nmeaEventIndex(Uint16 event)
+{
+	Uint16 bit;
+
+	for (bit = 0; bit < NMEA_STATS_TYPES; bit++)
+	{
+		if (event == (1 << bit))
+		{
+			return bit;
+		}
+	}
+
+	return NMEA_STATS_TYPES;
+}
+
+void nmeaSequenceStep(nmeaContext * context, Uint16 events)
+{
+	Uint16 bit;
+
+	for (bit = 0; events != 0 && bit < NMEA_STATS_TYPES; bit++, events >>= 1)
+	{
+		if (events & 1)
+		{
+			context->sequence[bit]++;
+		}
+	}
+}
+
+void nmeaSequenceBack(nmeaContext * context, Uint16 events)
+{
+	Uint16 bit;
+
+	for (bit = 0; events != 0 && bit < NMEA_STATS_TYPES; bit++, events >>= 1)
+	{
+		if (events & 1)
+		{
+			context->sequence[bit]--;
+		}
+	}
+}
+
+Uint16 nmeaReadRecord(const nmeaContext * context, Uint16 event, void * copy)
+{
+	Uint16 index;
+	Uint16 before;
+	const void * record;
+
+	index = nmeaEventIndex(event);
+	record = nmeaEventRecord(context, event);
+	if (index == NMEA_STATS_TYPES || record == NULL)
+	{
+		return 0;
+	}
+
+	do
+	{
+		// Wait for a write in progress on another core to finish
+		do
+		{
+			before = context->sequence[index];
+		} while (before & 1);
+
+		NMEA_ACQUIRE();
+		memcpy(copy, record, nmeaRecordSize[index]);
+		NMEA_ACQUIRE();
+	} while (context->sequence[index] != before);
+
+	return before >> 1;
+}
+
+/*----------------------------------------------------------------------------
+ Epoch assembler, see nmeaEpochFix in nmea_dec.h
+
+ Called after a sentence is decoded with what it reported, returns
+ NMEA_EVENT_EPOCH if that finished an epoch (context->epoch is then the
+ finished epoch).
+----------------------------------------------------------------------------*/
+Uint16 nmeaEpochAdd(nmeaContext * context, Uint16 events)
+{
+	nmeaEpochStage * stage;
+	nmeaEpochFix * fix;
+	const utcTime * utc;
+	Int32 time;
+	Uint16 published;
+	Uint16 i;
+
+	stage = &context->epochStage;
+	fix = &stage->fix;
+	published = 0;
+
+	// Which instant the sentence is for, if it says
+	utc = NULL;
+	time = NMEA_EPOCH_NOTIME;
+	if (events & NMEA_EVENT_FIX)
+	{
+		utc = &context->fixData.utcGpsTime;
+	}
+	else if (events & NMEA_EVENT_POSITION)
+	{
+		utc = &context->geographicPos.utcGpsTime;
+	}
+	else if (events & NMEA_EVENT_TIME)
+	{
+		utc = &context->dateTime.utcGpsTime;
+	}
+	else if ((events & NMEA_EVENT_NAVIGATION) && context->navigationData.utcEpoch != NMEA_GPRMC_NOTIME)
+	{
+		time = (Int32)(context->navigationData.utcEpoch % 86400UL);
+	}
+
+	// An empty time field says nothing about which epoch it is
+	if (utc != NULL && utc->utcHours == NMEA_UTC_NOTIME)
+	{
+		utc = NULL;
+	}
+
+	if (utc != NULL)
+	{
+		time = ((Int32)utc->utcHours * 3600L) + ((Int32)utc->utcMinutes * 60L) + utc->utcSeconds;
+	}
+
+	// The epoch being put together is over when the next one starts
+	if (fix->events != 0 &&
+		((time != NMEA_EPOCH_NOTIME && stage->time != NMEA_EPOCH_NOTIME && time != stage->time) ||
+		 (events & fix->events & NMEA_EPOCH_ONCE) != 0))
+	{
+		// It went to its deadline, so this is what the receiver sends
+		stage->expected |= fix->events;
+		if (stage->activeCount > stage->expectedActive)
+		{
+			stage->expectedActive = stage->activeCount;
+		}
+		published = nmeaEpochPublish(context);
+	}
+
+	if (time != NMEA_EPOCH_NOTIME)
+	{
+		stage->time = time;
+	}
+
+	// Merge in what it gave, the later sentence wins
+	if (utc != NULL)
+	{
+		fix->utcGpsTime = *utc;
+	}
+
+	if (events & NMEA_EVENT_POSITION)
+	{
+		fix->latitudeE7 = context->geographicPos.latitudeE7;
+		fix->longitudeE7 = context->geographicPos.longitudeE7;
+		fix->status = context->geographicPos.status;
+	}
+
+	if (events & NMEA_EVENT_FIX)
+	{
+		fix->latitudeE7 = context->fixData.latitudeE7;
+		fix->longitudeE7 = context->fixData.longitudeE7;
+		fix->altitude = context->fixData.altitude;
+		fix->fixQuality = context->fixData.fixQuality;
+
+		// GSA says more than GGA about the satellites
+		if ((fix->events & NMEA_EVENT_ACTIVE) == 0)
+		{
+			fix->hdop = context->fixData.hdop;
+			fix->usedCount = context->fixData.satellitesUsed;
+		}
+	}
+
+	if (events & NMEA_EVENT_NAVIGATION)
+	{
+		fix->utcEpoch = context->navigationData.utcEpoch;
+		fix->latitudeE7 = context->navigationData.latitudeE7;
+		fix->longitudeE7 = context->navigationData.longitudeE7;
+		fix->speed = context->navigationData.speed;
+		fix->course = context->navigationData.course;
+		fix->status = context->navigationData.status;
+	}
+
+	if (events & NMEA_EVENT_ACTIVE)
+	{
+		// The first GSA of the epoch replaces GGA's count, the rest add to it
+		if ((fix->events & NMEA_EVENT_ACTIVE) == 0)
+		{
+			fix->usedCount = 0;
+		}
+
+		fix->pdop = context->activeSats.pdop;
+		fix->hdop = context->activeSats.hdop;
+		fix->vdop = context->activeSats.vdop;
+		fix->fixMode = context->activeSats.fixMode;
+		fix->usedCount += context->activeSats.usedCount;
+		stage->activeCount++;
+		for (i = 0; i < NMEA_GPGSA_WORDS; i++)
+		{
+			fix->satellitesUsed[context->activeSats.constellation][i] |= context->activeSats.satellitesUsed[i];
+		}
+	}
+
+	if (events & NMEA_EVENT_VELOCITY)
+	{
+		if (context->velocity.speedKnots != NMEA_GPVTG_UNKNOWN)
+		{
+			fix->speed = context->velocity.speedKnots;
+		}
+
+		if (context->velocity.course != NMEA_GPVTG_UNKNOWN)
+		{
+			fix->course = context->velocity.course;
+		}
+	}
+
+	if (events & NMEA_EVENT_TIME)
+	{
+		fix->utcEpoch = context->dateTime.utcEpoch;
+	}
+
+	fix->events |= events & NMEA_EPOCH_SOURCES;
+
+	// Complete once it has everything an epoch has been seen to have,
+	// down to a GSA for each constellation. Until then a GSA that is
+	// still to come would be taken into the next epoch
+	if (!published && stage->expected != 0 && (fix->events & stage->expected) == stage->expected &&
+		stage->activeCount >= stage->expectedActive)
+	{
+		published = nmeaEpochPublish(context);
+	}
+
+	return published;
+}
+
+Uint16 nmeaEpochPublish(nmeaContext * context)
+{
+	nmeaEpochStage * stage;
+
+	stage = &context->epochStage;
+
+	// Written like a decoder's record, see nmeaReadRecord()
+	nmeaSequenceStep(context, NMEA_EVENT_EPOCH);
+	NMEA_RELEASE();
+	context->epoch = stage->fix;
+	NMEA_RELEASE();
+	nmeaSequenceStep(context, NMEA_EVENT_EPOCH);
+
+	memset(&stage->fix, 0, sizeof(nmeaEpochFix));
+	stage->time = NMEA_EPOCH_NOTIME;
+	stage->activeCount = 0;
+
+	return NMEA_EVENT_EPOCH;
+}
+
+Uint16 asciiToHex(Uint16 ascii)
+{
+	if (ascii >= '0' && ascii <= '9')
+	{
+		// Return the value minus ASCII '0'
+		return (ascii - '0');
+	}
+	else
+	{
+		// Return the value minus 0x37, which changes ASCII A to 0x0A etc.
+		return (ascii - 0x37);
+	}
+
+}
+
+Uint16 nmeaViewChar(const nmeaSentenceView * view, Uint16 offset)
+{
+	// Anything beyond the end of the sentence reads as the end marker,
+	// the ring itself no longer holds one
+	if (offset >= view->length)
+	{
+		return A_ETX;
+	}
+
+	return view->text[(view->start + offset) & (NMEABUFFSIZE - 1)];
+}
+
+Uint16 nmeaFieldLength(const nmeaSentenceView * view, Uint16 field)
+{
+	// Fields that aren't there (or that we didn't index) read as empty
+	if (field >= view->fieldCount || field >= NMEA_MAXFIELDS)
+	{
+		return 0;
+	}
+
+	return view->field[field + 1] - view->field[field] - 1;
+}
+
+/*----------------------------------------------------------------------------
+ Numeric fields
+
+ Every number in a sentence goes through nmeaParseDigits(), which reads
+ the run of ASCII digits at the start of some text (up to eight of them)
+ and says how many there were. On a 64 bit little endian host with a byte
+ ring (NMEA_SWAR and NMEA_PACKED_RING) long runs are done all at once in
+ one register: find the first byte that isn't '0'-'9' with two masks,
+ then add neighbouring digits together in pairs, fours and eights with
+ three multiplies. That takes the same time however many digits there
+ are, so it only pays from NMEA_SWAR_DIGITS on. Shorter runs, and
+ everything on the DSP, use a plain loop.
+
+ The word is built from two four byte loads that overlap, so it never
+ reads past the count it was given. The bytes above the count are 0,
+ which isn't a digit.
+
+ What it buys is small. On an x86-64 host (gcc -O2) a run of eight digits
+ reads in about half the time the loop takes, but the loop is already
+ about two cycles a digit and few fields have a run that long. Per field
+ (a count, an altitude, a time, a coordinate, 1e-7 degrees) the word
+ path and the loop are within a few ns of each other, and whole
+ sentences decode in the same time either way. It is nowhere near three
+ times faster per field.
+
+ The field readers below hand it the field text (see nmeaFieldText()),
+ then check the sign, decimal point etc. around the runs it read. A field
+ with anything else in it is flagged as bad rather than read as garbage.
+----------------------------------------------------------------------------*/
+#if defined(NMEA_SWAR) && defined(NMEA_PACKED_RING)
+#define NMEA_SWAR_DIGITS	6				// Shortest run worth doing as a word
+#endif
+#define NMEA_FIELDCOPY		NMEA_MAXLENGTH
+
+const Int32 nmeaPowersOf10[10] = {
+	1L, 10L, 100L, 1000L, 10000L, 100000L, 1000000L, 10000000L, 100000000L, 1000000000L
+};
+
+NMEA_INLINE Uint16 nmeaParseDigits(const nmeaChar * text, Uint16 count, Uint32 * value)
+{
+	Uint32 result;
+	Uint16 digit;
+	Uint16 digits;
+#if defined(NMEA_SWAR) && defined(NMEA_PACKED_RING)
+	Uint64 word;
+	Uint64 bad;
+	Uint32 low;
+	Uint32 high;
+#endif
+
+	if (count > 8)
+	{
+		count = 8;
+	}
+
+#if defined(NMEA_SWAR) && defined(NMEA_PACKED_RING)
+	if (count >= NMEA_SWAR_DIGITS)
+	{
+		// The first and last four chars, the overlap lands on itself and
+		// anything above count is left 0
+		memcpy(&low, text, sizeof(low));
+		memcpy(&high, &text[count - 4], sizeof(high));
+		word = (Uint64)low | ((Uint64)high << ((count - 4) * 8));
+
+		// Flag every byte that isn't 0x30-0x39, i.e. 0x3n before and after
+		// adding 6. A carry out of a byte that isn't a digit can only
+		// spoil the flags above it, and only the lowest flag counts
+		bad = ((word & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL) |
+			  (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL);
+		digits = (bad != 0) ? (Uint16)(__builtin_ctzll(bad) >> 3) : 8;
+		if (digits > count)
+		{
+			digits = count;
+		}
+		if (digits == 0)
+		{
+			*value = 0;
+			return 0;
+		}
+
+		// Right align the digits in a word of '0's, the first digit (the
+		// most significant) ends up in the lowest byte used and whatever
+		// follows them falls off the top
+		if (digits < 8)
+		{
+			word = (word << ((8 - digits) * 8)) | (0x3030303030303030ULL >> (digits * 8));
+		}
+
+		// Digits to values, then combine 8 x 1 digit into 4 x 2, 2 x 4, 1 x 8
+		word -= 0x3030303030303030ULL;
+		word = ((word * 10) + (word >> 8)) & 0x00FF00FF00FF00FFULL;
+		word = ((word * 100) + (word >> 16)) & 0x0000FFFF0000FFFFULL;
+		word = ((word * 10000) + (word >> 32)) & 0x00000000FFFFFFFFULL;
+
+		*value = (Uint32)word;
+		return digits;
+	}
+#endif
+
+	result = 0;
+	for (digits = 0; digits < count; digits++)
+	{
+		// Anything below '0' wraps round to a big number
+		digit = (Uint16)(text[digits] - '0');
+		if (digit > 9)
+		{
+			break;
+		}
+		result = (result * 10) + digit;
+	}
+
+	*value = result;
+	return digits;
+}
+
+/*----------------------------------------------------------------------------
+ Gets a field's characters as one run
+
+ Points straight into the view's text, unless the field runs past what
+ is readable, i.e. it wraps round the end of the ring. That's rare, and
+ then it is copied into copy (NMEA_FIELDCOPY chars) first.
+ Returns the length in *length, 0 if the field is empty or missing.
+----------------------------------------------------------------------------*/
+NMEA_INLINE const nmeaChar * nmeaFieldText(const nmeaSentenceView * view, Uint16 field, Uint16 * length, nmeaChar * copy)
+{
+	Uint16 i;
+
+	*length = nmeaFieldLength(view, field);
+	if (*length == 0)
+	{
+		return copy;
+	}
+
+	if (view->field[field] + *length <= view->readable)
+	{
+		return &view->text[(view->start + view->field[field]) & (NMEABUFFSIZE - 1)];
+	}
+
+	for (i = 0; i < *length; i++)
+	{
+		copy[i] = nmeaViewChar(view, view->field[field] + i);
+	}
+	return copy;
+}
+
+/*----------------------------------------------------------------------------
+ Reads a [-]x.x field as a fixed point value with the given number of
+ decimal places, e.g. "545.4" with two places reads as 54540
+
+ Up to nine digits before the point. Decimal places beyond 'places' are
+ dropped (but must still be digits), missing ones read as zero. Returns
+ FALSE, with a value of 0, for an empty field, one that isn't a number or
+ one too big for an Int32 once scaled up.
+----------------------------------------------------------------------------*/
+CSLBool nmeaFieldToNumber(const nmeaSentenceView * view, Uint16 field, Uint16 places, Int32 * value)
+{
+	nmeaChar copy[NMEA_FIELDCOPY];			// Only used if the field wraps
+	const nmeaChar * text;					// The field's characters
+	Uint16 length;							// How many
+	Uint16 pos;								// Where we are in text
+	Uint16 whole;							// Digits before the point
+	Uint16 taken;							// Decimal places read
+	Uint16 run;								// Digits in the last run read
+	Uint32 spare;							// Digits read but not kept
+	Uint32 number;							// Whole part
+	Uint32 fraction;						// Decimal places
+	CSLBool negative;						// Leading '-' seen
+
+	*value = 0;
+
+	text = nmeaFieldText(view, field, &length, copy);
+	if (length == 0 || places > 9)
+	{
+		return FALSE;
+	}
+
+	pos = 0;
+	negative = FALSE;
+	if (text[0] == A_MINUS || text[0] == A_PLUS)
+	{
+		negative = (text[0] == A_MINUS);
+		pos = 1;
+	}
+
+	// Whole part, no more than an Int32 can hold
+	whole = nmeaParseDigits(&text[pos], length - pos, &number);
+	pos += whole;
+	if (whole == 8 && pos < length && nmeaParseDigits(&text[pos], 1, &spare) == 1)
+	{
+		number = (number * 10) + spare;
+		whole++;
+		pos++;
+	}
+
+	// Decimal places, after the point. There has to be a digit on one
+	// side of it or the other
+	taken = 0;
+	fraction = 0;
+	if (pos < length)
+	{
+		if (text[pos] != A_FULLSTOP || (whole == 0 && pos + 1 == length))
+		{
+			return FALSE;
+		}
+		pos++;
+
+		taken = length - pos;
+		if (taken > places)
+		{
+			taken = places;
+		}
+		if (taken > 8)
+		{
+			taken = 8;
+		}
+		if (nmeaParseDigits(&text[pos], taken, &fraction) != taken)
+		{
+			return FALSE;
+		}
+
+		// Any more are dropped, but they still have to be digits
+		for (pos += taken; pos < length; pos += run)
+		{
+			run = nmeaParseDigits(&text[pos], length - pos, &spare);
+			if (run == 0)
+			{
+				return FALSE;
+			}
+		}
+	}
+	else if (whole == 0)
+	{
+		return FALSE;
+	}
+
+	// Anything with ten digits or more once scaled up could be too big,
+	// the rest can't be so are spared the divide
+	fraction *= (Uint32)nmeaPowersOf10[places - taken];
+	if (whole + places > 9 && number > (0x7FFFFFFFUL - fraction) / (Uint32)nmeaPowersOf10[places])
+	{
+		return FALSE;
+	}
+
+	number = (number * (Uint32)nmeaPowersOf10[places]) + fraction;
+	*value = negative ? -(Int32)number : (Int32)number;
+
+	return TRUE;
+}
+
+NMEA_INLINE CSLBool nmeaFieldToUint(const nmeaSentenceView * view, Uint16 field, Uint16 * value)
+{
+	Uint16 length;
+	Uint32 digits;
+	Int32 nmeaValue;
+	CSLBool valid;
+
+	// Nearly always a few plain digits that can be read straight out of
+	// the text. Anything else (wrapped, a decimal point, not a number) is
+	// left to the full reader. Whole part only, FALSE and 0 if it isn't a
+	// number or won't fit a Uint16, check nmeaFieldLength() where empty
+	// matters
+	*value = 0;
+	length = nmeaFieldLength(view, field);
+	if (length == 0)
+	{
+		return FALSE;
+	}
+	if (view->field[field] + length <= view->readable &&
+		nmeaParseDigits(&view->text[(view->start + view->field[field]) & (NMEABUFFSIZE - 1)], length, &digits) == length)
+	{
+		valid = (digits <= 0xFFFF);
+		nmeaValue = (Int32)digits;
+	}
+	else
+	{
+		valid = nmeaFieldToNumber(view, field, 0, &nmeaValue) && nmeaValue >= 0 && nmeaValue <= 0xFFFF;
+	}
+
+	if (valid)
+	{
+		*value = (Uint16)nmeaValue;
+	}
+	return valid;
+}
+
+/*----------------------------------------------------------------------------
+ Reads the three two digit numbers of a hhmmss(.ss) or ddmmyy field
+
+ Returns FALSE, with all three 0, if the field is shorter or they aren't
+ digits.
+----------------------------------------------------------------------------*/
+CSLBool nmeaFieldToPairs(const nmeaSentenceView * view, Uint16 field, Uint16 * first, Uint16 * second, Uint16 * third)
+{
+	nmeaChar copy[NMEA_FIELDCOPY];			// Only used if the field wraps
+	const nmeaChar * text;
+	Uint16 length;
+	Uint32 value1;
+	Uint32 value2;
+	Uint32 value3;
+
+	text = nmeaFieldText(view, field, &length, copy);
+
+	if (length < 6 ||
+		nmeaParseDigits(&text[0], 2, &value1) != 2 ||
+		nmeaParseDigits(&text[2], 2, &value2) != 2 ||
+		nmeaParseDigits(&text[4], 2, &value3) != 2)
+	{
+		*first = 0;
+		*second = 0;
+		*third = 0;
+		return FALSE;
+	}
+
+	*first = (Uint16)value1;
+	*second = (Uint16)value2;
+	*third = (Uint16)value3;
+	return TRUE;
+}
+
+/*----------------------------------------------------------------------------
+ Reads a DDMM.MMMM (or DDDMM.MMMM) field as its three parts
+
+ degreeDigits is 2 for latitude and 3 for longitude. The minutes'
+ decimal places are read to 'places' digits, fewer are scaled up to
+ that and any more are dropped (but must still be digits). Returns
+ FALSE, with all three 0, if it isn't a coordinate.
+----------------------------------------------------------------------------*/
+CSLBool nmeaFieldToCoordParts(const nmeaSentenceView * view, Uint16 field, Uint16 degreeDigits, Uint16 places,
+							  Uint32 * degrees, Uint32 * minutes, Uint32 * fraction)
+{
+	nmeaChar copy[NMEA_FIELDCOPY];			// Only used if the field wraps
+	const nmeaChar * text;
+	Uint16 length;
+	Uint16 whole;							// Digits before the point
+	Uint16 taken;							// Decimal places read
+	Uint16 pos;								// Where we are in text
+	Uint16 run;								// Digits in the last run read
+	Uint32 value;
+	Uint32 spare;							// Digits read but not kept
+
+	*degrees = 0;
+	*minutes = 0;
+	*fraction = 0;
+
+	text = nmeaFieldText(view, field, &length, copy);
+
+	// Degrees and whole minutes in one go, one or two minute digits
+	whole = nmeaParseDigits(text, length, &value);
+	if (whole <= degreeDigits || whole > degreeDigits + 2 ||
+		(whole < length && text[whole] != A_FULLSTOP))
+	{
+		return FALSE;
+	}
+
+	// Then the minutes' decimal places, if there are any
+	taken = (whole + 1 < length) ? length - whole - 1 : 0;
+	if (taken > places)
+	{
+		taken = places;
+	}
+	if (nmeaParseDigits(&text[whole + 1], taken, fraction) != taken)
+	{
+		*fraction = 0;
+		return FALSE;
+	}
+
+	// Any more are dropped, but they still have to be digits
+	for (pos = whole + 1 + taken; pos < length; pos += run)
+	{
+		run = nmeaParseDigits(&text[pos], length - pos, &spare);
+		if (run == 0)
+		{
+			*fraction = 0;
+			return FALSE;
+		}
+	}
+
+	if (whole - degreeDigits == 2)
+	{
+		*degrees = value / 100;
+		*minutes = value % 100;
+	}
+	else
+	{
+		*degrees = value / 10;
+		*minutes = value % 10;
+	}
+	*fraction *= nmeaPowersOf10[places - taken];
+	return TRUE;
+}
+
+/*----------------------------------------------------------------------------
+ Reads a DDMM.MMMM (or DDDMM.MMMM) field, and the N/S/E/W field after it,
+ both as a gpsCoord and as a signed number of 1e-7 degrees
+
+ degreeDigits is 2 for latitude and 3 for longitude. The field is read
+ once, with the minutes to seven places (fewer are padded, more are
+ dropped as they are below 1e-7 degrees anyway). The gpsCoord keeps the
+ first NMEA_GPGLL_PRECISION of them. The 1e-7 degrees are the minutes
+ divided by 60 with rounding; the largest value, 180 degrees, is
+ 1,800,000,000, which fits an Int32. S and W make both negative.
+ Returns FALSE, with all zeros, if it is empty or isn't a coordinate.
+----------------------------------------------------------------------------*/
+CSLBool nmeaFieldToCoord(const nmeaSentenceView * view, Uint16 field, Uint16 degreeDigits, gpsCoord * coord, Int32 * e7)
+{
+	Uint32 degrees;							// Whole degrees
+	Uint32 minutes;							// Whole minutes
+	Uint32 fraction;						// Minutes' decimal places x 1e7
+	Uint16 nmeaValueChar;
+
+	coord->gpsDegrees = 0;
+	coord->gpsMinutes = 0;
+	coord->gpsSubMinutes = 0;
+	*e7 = 0;
+
+	if (!nmeaFieldToCoordParts(view, field, degreeDigits, 7, &degrees, &minutes, &fraction))
+	{
+		return FALSE;
+	}
+
+	coord->gpsDegrees = (Int16)degrees;
+	coord->gpsMinutes = (Int16)minutes;
+	coord->gpsSubMinutes = (Int16)(fraction / (Uint32)nmeaPowersOf10[7 - NMEA_GPGLL_PRECISION]);
+	*e7 = (Int32)((degrees * 10000000UL) + ((minutes * 10000000UL) + fraction + 30) / 60);
+
+	if (nmeaFieldLength(view, field + 1) != 0)
+	{
+		nmeaValueChar = nmeaViewChar(view, view->field[field + 1]);
+		if (nmeaValueChar == A_S || nmeaValueChar == A_s || nmeaValueChar == A_W || nmeaValueChar == A_w)
+		{
+			coord->gpsDegrees = -coord->gpsDegrees;
+			*e7 = -*e7;
+		}
+	}
+
+	return TRUE;
+}
+
+/*----------------------------------------------------------------------------
+ Reads a hhmmss.ss field into a utcTime (we ignore parts of seconds)
+
+ An empty field means the receiver doesn't know the time yet, which
+ reads as NMEA_UTC_NOTIME hours. Returns FALSE for that, and for anything
+ that isn't a time (which reads as all zeros).
+----------------------------------------------------------------------------*/
+CSLBool nmeaFieldToTime(const nmeaSentenceView * view, Uint16 field, utcTime * time)
+{
+	Uint16 hours;
+	Uint16 minutes;
+	Uint16 seconds;
+	CSLBool valid;
+
+	valid = nmeaFieldToPairs(view, field, &hours, &minutes, &seconds);
+
+	time->utcHours = hours;
+	time->utcMinutes = minutes;
+	time->utcSeconds = seconds;
+	if (!valid && nmeaFieldLength(view, field) == 0)
+	{
+		time->utcHours = NMEA_UTC_NOTIME;
+	}
+	return valid;
+}
+
+/*----------------------------------------------------------------------------
+ Converts a UTC date and time to seconds since 1st Jan 1970
+
+ Counts days with March as the first month of the year, so the leap day
+ is the last day of the year and the month lengths follow a simple
+ pattern (the "days from civil" method). Good from 1970 to 2105, and
+ all in 32 bit integers.
+----------------------------------------------------------------------------*/
+Uint32 nmeaEpochSeconds(Uint16 year, Uint16 month, Uint16 day, const utcTime * time)
+{
+	Uint32 years;							// Years since 1st March 0000
+	Uint32 dayOfYear;						// Days since 1st March this year
+	Uint32 days;							// Days since 1st Jan 1970
+
+	years = (month <= 2) ? (Uint32)year - 1 : (Uint32)year;
+	dayOfYear = ((153 * (Uint32)((month <= 2) ? month + 9 : month - 3)) + 2) / 5 + day - 1;
+	days = (years * 365) + (years / 4) - (years / 100) + (years / 400) + dayOfYear - 719468;
+
+	return (days * 86400) + ((Uint32)time->utcHours * 3600) + ((Uint32)time->utcMinutes * 60) + time->utcSeconds;
+}
+
+/*----------------------------------------------------------------------------
+ Reads a single character field, e.g. the FAA mode, missing if it's empty
+----------------------------------------------------------------------------*/
+Uint16 nmeaFieldToChar(const nmeaSentenceView * view, Uint16 field, Uint16 missing)
+{
+	if (nmeaFieldLength(view, field) == 0)
+	{
+		return missing;
+	}
+
+	return nmeaViewChar(view, view->field[field]);
+}
+
+/*----------------------------------------------------------------------------
+ Reads an A (valid) or V (invalid) status field, missing if it's empty
+ or anything else
+----------------------------------------------------------------------------*/
+Uint16 nmeaFieldToStatus(const nmeaSentenceView * view, Uint16 field, Uint16 missing)
+{
+	Uint16 nmeaValueChar;
+
+	if (nmeaFieldLength(view, field) == 0)
+	{
+		return missing;
+	}
+
+	nmeaValueChar = nmeaViewChar(view, view->field[field]);
+	if (nmeaValueChar == A_A || nmeaValueChar == A_a)
+	{
+		return NMEA_GPGLL_VALID;
+	}
+	if (nmeaValueChar == A_V || nmeaValueChar == A_v)
+	{
+		return NMEA_GPGLL_INVALID;
+	}
+
+	return missing;
+}
+
+/*----------------------------------------------------------------------------
+ Reads a fixed point value that is negative if the field after it is W,
+ such as the magnetic variation. missing if the value is empty, FALSE
+ (and 0) only if it is there but isn't a number
+----------------------------------------------------------------------------*/
+CSLBool nmeaFieldToFixedEW(const nmeaSentenceView * view, Uint16 field, Uint16 places, Int32 missing, Int32 * value)
+{
+	Int32 nmeaValue;
+	Uint16 nmeaValueChar;
+
+	if (nmeaFieldLength(view, field) == 0)
+	{
+		*value = missing;
+		return TRUE;
+	}
+
+	if (!nmeaFieldToNumber(view, field, places, &nmeaValue))
+	{
+		*value = 0;
+		return FALSE;
+	}
+
+	nmeaValueChar = nmeaViewChar(view, view->field[field + 1]);
+	if (nmeaFieldLength(view, field + 1) != 0 && (nmeaValueChar == A_W || nmeaValueChar == A_w))
+	{
+		nmeaValue = -nmeaValue;
+	}
+
+	*value = nmeaValue;
+	return TRUE;
+}
+
+/*----------------------------------------------------------------------------
+ Reads a ddmmyy date field and the hhmmss time in timeField as seconds
+ since 1970, or NMEA_GPRMC_NOTIME unless both are there and make sense
+
+ Two digit years from 80 on are 1980-1999, the rest are 2000-2079.
+ Returns FALSE if either field is there but isn't a date or time, an
+ empty one is just NMEA_GPRMC_NOTIME.
+----------------------------------------------------------------------------*/
+CSLBool nmeaFieldToEpoch(const nmeaSentenceView * view, Uint16 field, Uint16 timeField, Uint32 * epoch)
+{
+	Uint16 day;
+	Uint16 month;
+	Uint16 year;
+	utcTime time;
+
+	*epoch = NMEA_GPRMC_NOTIME;
+
+	if (nmeaFieldLength(view, timeField) == 0 || nmeaFieldLength(view, field) == 0)
+	{
+		return TRUE;
+	}
+
+	if (nmeaFieldLength(view, field) != 6 ||
+		!nmeaFieldToPairs(view, field, &day, &month, &year) ||
+		!nmeaFieldToTime(view, timeField, &time))
+	{
+		return FALSE;
+	}
+
+	year += (year >= 80) ? 1900 : 2000;
+	if (month < 1 || month > 12 || day < 1 || day > 31)
+	{
+		return FALSE;
+	}
+
+	*epoch = nmeaEpochSeconds(year, month, day, &time);
+	return TRUE;
+}
+
+/*----------------------------------------------------------------------------
+ As nmeaFieldToEpoch(), but for a date sent as separate day, month and
+ four digit year fields, starting at field
+----------------------------------------------------------------------------*/
+CSLBool nmeaFieldToEpochDMY(const nmeaSentenceView * view, Uint16 field, Uint16 timeField, Uint32 * epoch)
+{
+	Uint16 day;
+	Uint16 month;
+	Uint16 year;
+	utcTime time;
+
+	*epoch = NMEA_GPRMC_NOTIME;
+
+	if (nmeaFieldLength(view, timeField) == 0 || nmeaFieldLength(view, field) == 0 ||
+		nmeaFieldLength(view, field + 1) == 0 || nmeaFieldLength(view, field + 2) == 0)
+	{
+		return TRUE;
+	}
+
+	if (nmeaFieldLength(view, field + 2) != 4 ||
+		!nmeaFieldToUint(view, field, &day) ||
+		!nmeaFieldToUint(view, field + 1, &month) ||
+		!nmeaFieldToUint(view, field + 2, &year) ||
+		!nmeaFieldToTime(view, timeField, &time))
+	{
+		return FALSE;
+	}
+
+	if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31)
+	{
+		return FALSE;
+	}
+
+	*epoch = nmeaEpochSeconds(year, month, day, &time);
+	return TRUE;
+}
+
+
+/*----------------------------------------------------------------------------
+ Sky table, see nmea_dec.h
+
+ The index is open addressed with linear probing, the same as the
+ decoder lookup, and holds slot numbers. Keys are the constellation and
+ PRN together, so the same PRN from two constellations never clashes.
+----------------------------------------------------------------------------*/
+void nmeaSkyInit(nmeaSkyTable * sky)
+{
+	Uint16 i;
+
+	sky->count = 0;
+
+	for (i = 0; i < NMEA_SKYINDEXSIZE; i++)
+	{
+		sky->index[i] = NMEA_SKY_NONE;
+	}
+
+	for (i = 0; i < NMEA_CONSTELLATIONS; i++)
+	{
+		sky->satellitesInView[i] = 0;
+	}
+}
+
+Uint16 nmeaSkyHash(Uint16 constellation, Uint16 prn)
+{
+	Uint32 key;
+
+	key = ((Uint32)constellation << 8) | (prn & 0xFF);
+
+	// Multiplicative hash as nmeaDispatchHash(), top seven bits
+	return (Uint16)((Uint32)(key * 0x9E3779B1UL) >> 25) & (NMEA_SKYINDEXSIZE - 1);
+}
+
+Uint16 nmeaSkyFind(const nmeaSkyTable * sky, Uint16 constellation, Uint16 prn)
+{
+	Uint16 entry;
+	Uint16 slot;
+	Uint16 i;
+
+	entry = nmeaSkyHash(constellation, prn);
+
+	for (i = 0; i < NMEA_SKYINDEXSIZE; i++)
+	{
+		slot = sky->index[entry];
+
+		if (slot == NMEA_SKY_NONE)
+		{
+			break;
+		}
+
+		if (sky->prn[slot] == prn && sky->constellation[slot] == constellation)
+		{
+			return slot;
+		}
+
+		entry = (entry + 1) & (NMEA_SKYINDEXSIZE - 1);
+	}
+
+	return NMEA_SKY_NONE;
+}
+
+Uint16 nmeaSkyAdd(nmeaSkyTable * sky, Uint16 constellation, Uint16 prn)
+{
+	Uint16 entry;
+	Uint16 slot;
+	Uint16 i;
+
+	entry = nmeaSkyHash(constellation, prn);
+
+	// Either find it, or the empty entry it would have been in
+	for (i = 0; i < NMEA_SKYINDEXSIZE; i++)
+	{
+		slot = sky->index[entry];
+
+		if (slot == NMEA_SKY_NONE)
+		{
+			break;
+		}
+
+		if (sky->prn[slot] == prn && sky->constellation[slot] == constellation)
+		{
+			return slot;
+		}
+
+		entry = (entry + 1) & (NMEA_SKYINDEXSIZE - 1);
+	}
+
+	if (sky->count >= NMEA_SKYSIZE)
+	{
+		return NMEA_SKY_NONE;
+	}
+
+	// New satellites go on the end, keeping the columns packed. The
+	// caller fills in the rest of the columns
+	slot = sky->count;
+	sky->prn[slot] = prn;
+	sky->constellation[slot] = constellation;
+	sky->index[entry] = slot;
+	sky->count++;
+
+	return slot;
+}
+
+void nmeaSkyClear(nmeaSkyTable * sky, Uint16 constellation)
+{
+	Uint16 from;
+	Uint16 to;
+
+	// Pack the satellites we keep down over the ones we don't
+	to = 0;
+	for (from = 0; from < sky->count; from++)
 	{
-		// Hours first
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		geographicPos.utcGpsTime.utcHours = nmeaTemp1;
-		// minutes next
-		nmeaTemp1 = 0;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		geographicPos.utcGpsTime.utcMinutes = nmeaTemp1;
-		// Seconds last
-		nmeaTemp1 = 0;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		nmeaTemp1 *= 10;
-		nmeaTemp1 += asciiToHex(nmeaBufferLocal[nmeaDataOut]);
-		incDataPointer(&nmeaDataOut);
-		geographicPos.utcGpsTime.utcSeconds = nmeaTemp1;
+		if (sky->constellation[from] == constellation)
+		{
+			continue;
+		}
+
+		if (to != from)
+		{
+			sky->prn[to] = sky->prn[from];
+			sky->constellation[to] = sky->constellation[from];
+			sky->elevation[to] = sky->elevation[from];
+			sky->azimuth[to] = sky->azimuth[from];
+			sky->signalNoiseRatio[to] = sky->signalNoiseRatio[from];
+		}
+		to++;
 	}
 
-	// Now increment until we reach the next comma
-	// (skipping the fractions of seconds)
-	while (nmeaBufferLocal[nmeaDataOut] != A_COMMA)
+	// Slots have moved, so index everything left again (nmeaSkyAdd()
+	// gives them the same slots, in order, and leaves the columns alone)
+	sky->count = 0;
+	for (from = 0; from < NMEA_SKYINDEXSIZE; from++)
+	{
+		sky->index[from] = NMEA_SKY_NONE;
+	}
+	for (from = 0; from < to; from++)
 	{
-		incDataPointer(&nmeaDataOut);
+		nmeaSkyAdd(sky, sky->constellation[from], sky->prn[from]);
 	}
 
-	// Move pointer past the comma we are pointing to
-	incDataPointer(&nmeaDataOut);
+	sky->satellitesInView[constellation] = 0;
+}
+
+
+/*----------------------------------------------------------------------------
+ Decoders generated from the sentence schemas in nmea_dec.h
+
+ NMEA_READ_FIELD turns one schema row into the call for its kind, so
+ NMEA_xxx_SCHEMA(NMEA_READ_FIELD) inside a decoder is the whole decode,
+ one straight line call per field. They expect the sentence to be called
+ sentence, the structure being filled in record, and a CSLBool valid
+ that starts off TRUE; UINT and FIXED rows also need a Uint16 nmeaUint
+ and an Int32 nmeaFixed to read into.
+
+ A field that is there but can't be read clears valid, and the decoder
+ then drops the whole sentence rather than pass on a 0 that was never
+ sent. An empty field is fine, it is set to its missing value. A missing
+ value of 0 costs nothing for UINT and FIXED, as an empty field reads as
+ 0 anyway, so the length is only checked for the others.
+----------------------------------------------------------------------------*/
+#define NMEA_READ_FIELD(kind, ...) \
+	NMEA_READ_##kind(__VA_ARGS__);
+
+#define NMEA_READ_EMPTY(field)	(nmeaFieldLength(sentence, field) == 0)
+
+#define NMEA_READ_TIME(field, member) \
+	valid &= nmeaFieldToTime(sentence, field, &record->member) || NMEA_READ_EMPTY(field)
+#define NMEA_READ_COORD(field, member, degreeDigits) \
+	valid &= nmeaFieldToCoord(sentence, field, degreeDigits, &record->member, &record->member##E7) || \
+			 NMEA_READ_EMPTY(field)
+#define NMEA_READ_UINT(field, member, missing) \
+	valid &= nmeaFieldToUint(sentence, field, &nmeaUint) || NMEA_READ_EMPTY(field); \
+	record->member = ((missing) == 0 || !NMEA_READ_EMPTY(field)) ? nmeaUint : (missing)
+#define NMEA_READ_FIXED(field, member, places, missing) \
+	valid &= nmeaFieldToNumber(sentence, field, places, &nmeaFixed) || NMEA_READ_EMPTY(field); \
+	record->member = ((missing) == 0 || !NMEA_READ_EMPTY(field)) ? nmeaFixed : (missing)
+#define NMEA_READ_FIXED_EW(field, member, places, missing) \
+	valid &= nmeaFieldToFixedEW(sentence, field, places, missing, &nmeaFixed); \
+	record->member = nmeaFixed
+#define NMEA_READ_CHAR(field, member, missing) \
+	record->member = nmeaFieldToChar(sentence, field, missing)
+#define NMEA_READ_STATUS(field, member, missing) \
+	record->member = nmeaFieldToStatus(sentence, field, missing)
+#define NMEA_READ_EPOCH(field, member, timeField) \
+	valid &= nmeaFieldToEpoch(sentence, field, timeField, &record->member)
+#define NMEA_READ_EPOCH_DMY(field, member, timeField) \
+	valid &= nmeaFieldToEpochDMY(sentence, field, timeField, &record->member)
+
+/*----------------------------------------------------------------------------
+
+ GSV - Satellites in view
+
+These sentences describe the sky position of a UPS satellite in view.
+Typically they're shipped in a group of 2 or 3, more with a multi-GNSS
+receiver.
+
+          1 2 3 4 5 6 7     n
+         | | | | | | |     |
+ $--GSV,x,x,x,x,x,x,x,...*hh<CR><LF>
+
+ Field Number: 
+  1) total number of messages
+  2) message number
+  3) satellites in view
+  4) satellite number
+  5) elevation in degrees (0-90)
+  6) azimuth in degrees to true north (0-359)
+  7) SNR in dB (0-99)
+  more satellite infos like 4)-7)
+  n) checksum (NMEA 4.1 adds a signal ID just before it)
+
+Example:
+    $GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74
+    $GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00*74
+    $GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D
+
+The messages of a cycle are collected in context->gsvStage, see
+nmea_dec.h, and nothing goes into the sky table until the last one is
+in. Then the constellation's satellites are replaced by the cycle's in
+one go and NMEA_EVENT_SATELLITES is returned; the other messages return
+0. The last message of a cycle may have fewer than four satellites (or
+empty ones), only satellites that are there are stored.
+----------------------------------------------------------------------------*/
+Uint16 GPGSV_decode(nmeaContext * context, const nmeaSentenceView * sentence)
+{
+	Uint16  nmeaMessages;					// Messages in the cycle
+	Uint16  nmeaMessage;					// Which one this is
+	Uint16  nmeaCount;						// Counter for this function
+	Uint16  nmeaField;						// Field holding the satellite number
+	Uint16  nmeaPrn;						// Satellite being read
+	Uint16  nmeaElevation;
+	Uint16  nmeaAzimuth;
+	Uint16  nmeaSnr;
+	nmeaGsvStage * stage;
+
+	NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GPGSV, 0, 0, 0, 0);
 
-	// Read out the validity value
-	if (nmeaBufferLocal[nmeaDataOut] == A_A ||\
-		nmeaBufferLocal[nmeaDataOut] == A_a)
+	stage = &context->gsvStage;
+
+	// Read out the number of messages and message number
+	if (!nmeaFieldToUint(sentence, 1, &nmeaMessages) || !nmeaFieldToUint(sentence, 2, &nmeaMessage) ||
+		nmeaMessage == 0 || nmeaMessage > nmeaMessages || nmeaMessages > NMEA_GSV_MESSAGES)
 	{
-		geographicPos.status = NMEA_GPGLL_VALID;
+		nmeaGsvDrop(context);
+		context->stats.malformed++;
+		NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GSV_NUMBER, 0, 0, 0, 0);
+		return 0;
 	}
-	else if (nmeaBufferLocal[nmeaDataOut] == A_V ||\
-		nmeaBufferLocal[nmeaDataOut] == A_v)
+
+	if (nmeaMessage == 1)
 	{
-		geographicPos.status = NMEA_GPGLL_INVALID;
+		// The first message of a cycle starts collecting afresh
+		nmeaGsvDrop(context);
+		stage->messages = nmeaMessages;
+		stage->nextMessage = 1;
+		stage->constellation = context->constellation;
+		nmeaFieldToUint(sentence, 3, &stage->satellitesInView);
+		stage->count = 0;
 	}
-	else
+	else if (stage->messages != nmeaMessages || stage->nextMessage != nmeaMessage ||
+			 stage->constellation != context->constellation ||
+			 (Uint16)(context->sentences - stage->lastSentence) > NMEA_GSV_TIMEOUT)
 	{
-		// We should never get here
-		geographicPos.status = NMEA_GPGLL_ERROR;
+		// Not the next part of the cycle being collected, the rest of
+		// this one is no use without its first message
+		nmeaGsvDrop(context);
+		return 0;
 	}
 
-	// Move pointer past status value we are pointing to
-	incDataPointer(&nmeaDataOut);
+	stage->nextMessage++;
+	stage->lastSentence = context->sentences;
 
-	// Now, if we haven't reached the end, read FAA code
-	if (nmeaBufferLocal[nmeaDataOut] != A_ETX)
+	// Each satellite is four fields, number, elevation, azimuth and SNR
+	// no more than four sat's per sentence
+	for (nmeaCount = 0; nmeaCount < 4 && stage->count < NMEA_GSV_STAGESIZE; nmeaCount++)
 	{
-		geographicPos.faaMode = nmeaBufferLocal[nmeaDataOut];
-		incDataPointer(&nmeaDataOut);
+		nmeaField = 4 + (nmeaCount * 4);
+
+		// Stop when the sentence has no more satellites (at least the
+		// number, elevation and azimuth fields must be there)
+		if (nmeaField + 2 >= sentence->fieldCount)
+		{
+			break;
+		}
+
+		// Skip empty ones
+		if (nmeaFieldLength(sentence, nmeaField) == 0)
+		{
+			continue;
+		}
+
+		// Note, sometimes no SNR at end of sentence (or no elevation and
+		// azimuth for one not yet placed), which reads as 0. One that is
+		// there but isn't a number spoils the cycle
+		if (!nmeaFieldToUint(sentence, nmeaField, &nmeaPrn) ||
+			(!nmeaFieldToUint(sentence, nmeaField + 1, &nmeaElevation) && nmeaFieldLength(sentence, nmeaField + 1) != 0) ||
+			(!nmeaFieldToUint(sentence, nmeaField + 2, &nmeaAzimuth) && nmeaFieldLength(sentence, nmeaField + 2) != 0) ||
+			(!nmeaFieldToUint(sentence, nmeaField + 3, &nmeaSnr) && nmeaFieldLength(sentence, nmeaField + 3) != 0))
+		{
+			nmeaGsvDrop(context);
+			context->stats.malformed++;
+			return 0;
+		}
+
+		stage->prn[stage->count] = nmeaPrn;
+		stage->elevation[stage->count] = nmeaElevation;
+		stage->azimuth[stage->count] = nmeaAzimuth;
+		stage->signalNoiseRatio[stage->count] = nmeaSnr;
+		stage->count++;
 	}
-	else
+
+	// Wait for the rest of the cycle
+	if (nmeaMessage < nmeaMessages)
 	{
-		geographicPos.faaMode = NMEA_GPGLL_UNKNOWN;
+		return 0;
 	}
 
-	// The following is a debug routine to check that the GSP location
-	// values are not too large - think values are being corrupted by the 
-	// circular buffer, and this screws up our calculations
-/*	{
-		if (geographicPos.latitude.gpsDegrees > 90)
-		{
-			geographicPos.status =  NMEA_GPGLL_INVALID;
-		}
-		if (geographicPos.latitude.gpsMinutes > 59 || geographicPos.latitude.gpsMinutes < 0)
+	nmeaGsvPublish(context);
+
+#ifdef OUTPUT_GPGSV_DATA
+	outputGPGSV(context);
+#endif
+
+	return NMEA_EVENT_SATELLITES;
+}
+
+void nmeaGsvDrop(nmeaContext * context)
+{
+	nmeaGsvStage * stage;
+
+	stage = &context->gsvStage;
+	if (stage->messages != 0)
+	{
+		context->stats.partialCycles++;
+		NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GSV_DROPPED, stage->nextMessage - 1, stage->messages, 0, 0);
+		stage->messages = 0;
+	}
+}
+
+void nmeaGsvPublish(nmeaContext * context)
+{
+	Uint16 i;
+	Uint16 slot;
+	nmeaGsvStage * stage;
+	nmeaSkyTable * sky;
+
+	stage = &context->gsvStage;
+	sky = &context->sky;
+
+	// This constellation's satellites are replaced by the whole cycle
+	nmeaSkyClear(sky, stage->constellation);
+	sky->satellitesInView[stage->constellation] = stage->satellitesInView;
+
+	for (i = 0; i < stage->count; i++)
+	{
+		slot = nmeaSkyAdd(sky, stage->constellation, stage->prn[i]);
+		if (slot == NMEA_SKY_NONE)
 		{
-			geographicPos.status =  NMEA_GPGLL_INVALID;
+			NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_SKY_FULL, stage->constellation, stage->prn[i], 0, 0);
+			break;
 		}
-		if (geographicPos.latitude.gpsSubMinutes > 9999 || geographicPos.latitude.gpsSubMinutes < 0)
+
+		sky->elevation[slot] = stage->elevation[i];
+		sky->azimuth[slot] = stage->azimuth[i];
+		sky->signalNoiseRatio[slot] = stage->signalNoiseRatio[i];
+	}
+
+	stage->messages = 0;
+}
+
+/*----------------------------------------------------------------------------
+
+ GLL - Geographic Position - Latitude/Longitude
+
+          1       2 3        4 5         6 7   8
+         |       | |        | |         | |   |
+ $--GLL,llll.ll,a,yyyyy.yy,a,hhmmss.ss,a,m,*hh<CR><LF>
+
+ Field Number: 
+  1) Latitude
+  2) N or S (North or South)
+  3) Longitude
+  4) E or W (East or West)
+  5) Universal Time Coordinated (UTC)
+  6) Status A - Data Valid, V - Data Invalid
+  7) FAA mode indicator (NMEA 2.3 and later)
+  8) Checksum
+
+Introduced in NMEA 3.0.
+
+----------------------------------------------------------------------------*/
+Uint16 GPGLL_decode(nmeaContext * context, const nmeaSentenceView * sentence)
+{
+	nmeaGeographicPosition position;		// Read here, kept if every field reads
+	nmeaGeographicPosition * record;
+	CSLBool valid;
+
+	NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GPGLL, 0, 0, 0, 0);
+
+	record = &position;
+	record->constellation = context->constellation;
+	valid = TRUE;
+
+	NMEA_GPGLL_SCHEMA(NMEA_READ_FIELD)
+
+	if (!valid)
+	{
+		context->stats.malformed++;
+		return 0;
+	}
+	context->geographicPos = position;
+
+#ifdef OUTPUT_GPGLL_DATA
+	outputGPGLL(context);
+#endif
+
+	return NMEA_EVENT_POSITION;
+}
+
+/*----------------------------------------------------------------------------
+
+GGA - Global Positioning System Fix Data
+Time, Position and fix related data for a GPS receiver.
+
+          1         2       3 4        5 6 7  8   9  10 |  12 13  14   15
+         |         |       | |        | | |  |   |   | |   | |   |    |
+ $--GGA,hhmmss.ss,llll.ll,a,yyyyy.yy,a,x,xx,x.x,x.x,M,x.x,M,x.x,xxxx*hh<CR><LF>
+
+ Field Number: 
+  1) Universal Time Coordinated (UTC)
+  2) Latitude
+  3) N or S (North or South)
+  4) Longitude
+  5) E or W (East or West)
+  6) GPS Quality Indicator
+  7) Number of satellites in use, 00 - 12
+  8) Horizontal Dilution of precision
+  9) Antenna Altitude above/below mean-sea-level (geoid) (in meters)
+ 10) Units of antenna altitude, meters
+ 11) Geoidal separation (in meters)
+ 12) Units of geoidal separation, meters
+ 13) Age of differential GPS data (seconds), null when DGPS is not used
+ 14) Differential reference station ID, 0000-1023
+ 15) Checksum
+
+Example:
+    $GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47
+
+Everything is read as fixed point (see nmeaFixData), the units fields
+are always M so we don't look at them.
+----------------------------------------------------------------------------*/
+Uint16 GPGGA_decode(nmeaContext * context, const nmeaSentenceView * sentence)
+{
+	nmeaFixData fix;						// Read here, kept if every field reads
+	nmeaFixData * record;
+	Uint16 nmeaUint;
+	Int32 nmeaFixed;
+	CSLBool valid;
+
+	NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GPGGA, 0, 0, 0, 0);
+
+	record = &fix;
+	record->constellation = context->constellation;
+	valid = TRUE;
+
+	NMEA_GPGGA_SCHEMA(NMEA_READ_FIELD)
+
+	if (!valid)
+	{
+		context->stats.malformed++;
+		return 0;
+	}
+	context->fixData = fix;
+
+#ifdef OUTPUT_GPGGA_DATA
+	outputGPGGA(context);
+#endif
+
+	return NMEA_EVENT_FIX;
+}
+
+/*----------------------------------------------------------------------------
+
+ RMC - Recommended Minimum Navigation Information
+                                                              12
+          1         2 3       4 5        6  7   8   9    10 11|  13
+         |         | |       | |        |  |   |   |    |  | |   |
+ $--RMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,xxxx,x.x,a,m,*hh<CR><LF>
+
+ Field Number: 
+  1) UTC Time
+  2) Status, V=Navigation receiver warning A=Valid
+  3) Latitude
+  4) N or S
+  5) Longitude
+  6) E or W
+  7) Speed over ground, knots
+  8) Track made good, degrees true
+  9) Date, ddmmyy
+ 10) Magnetic Variation, degrees
+ 11) E or W
+ 12) FAA mode indicator (NMEA 2.3 and later)
+ 13) Checksum
+
+Example:
+    $GPRMC,225446,A,4916.45,N,12311.12,W,000.5,054.7,191194,020.3,E*68
+
+The date and time are turned into one epoch value here, once, so nothing
+downstream has to (see nmeaFieldToEpoch()).
+----------------------------------------------------------------------------*/
+Uint16 GPRMC_decode(nmeaContext * context, const nmeaSentenceView * sentence)
+{
+	nmeaNavigationData navigation;			// Read here, kept if every field reads
+	nmeaNavigationData * record;
+	Int32 nmeaFixed;
+	CSLBool valid;
+
+	NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GPRMC, 0, 0, 0, 0);
+
+	record = &navigation;
+	record->constellation = context->constellation;
+	valid = TRUE;
+
+	NMEA_GPRMC_SCHEMA(NMEA_READ_FIELD)
+
+	if (!valid)
+	{
+		context->stats.malformed++;
+		return 0;
+	}
+	context->navigationData = navigation;
+
+#ifdef OUTPUT_GPRMC_DATA
+	outputGPRMC(context);
+#endif
+
+	return NMEA_EVENT_NAVIGATION;
+}
+
+/*----------------------------------------------------------------------------
+
+ GSA - GPS DOP and active satellites
+
+          1 2 3                  14 15  16  17  18
+         | | |                   |  |   |   |   |
+ $--GSA,a,a,x,x,x,x,x,x,x,x,x,x,x,x,x,x,x.x,x.x,x.x*hh<CR><LF>
+
+ Field Number: 
+  1) Selection mode
+  2) Mode (1 = no fix, 2 = 2D fix, 3 = 3D fix)
+  3) ID of 1st satellite used for fix
+  ...
+  14) ID of 12th satellite used for fix
+  15) PDOP
+  16) HDOP
+  17) VDOP
+  18) checksum
+
+Example:
+    $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39
+
+Unused slots are empty and may be anywhere in the twelve. The IDs go
+into a bitmap rather than a list, so checking a satellite against the
+fix, or the whole set against the GSV table, needs no searching.
+----------------------------------------------------------------------------*/
+Uint16 GPGSA_decode(nmeaContext * context, const nmeaSentenceView * sentence)
+{
+	Uint16  nmeaTemp1;						// Temp var for use during decoding
+	Uint16  nmeaCount;						// Counter for this function
+	Int32   nmeaDop[3];						// PDOP, HDOP and VDOP
+	CSLBool valid;
+	nmeaActiveSatellites gsa;				// Read here, kept if every field reads
+	nmeaActiveSatellites * active;
+
+	NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GPGSA, 0, 0, 0, 0);
+
+	active = &gsa;
+	active->constellation = context->constellation;
+
+	// Selection mode is a single char, fix mode a single digit
+	if (nmeaFieldLength(sentence, 1) != 0)
+	{
+		active->selectionMode = nmeaViewChar(sentence, sentence->field[1]);
+	}
+	else
+	{
+		active->selectionMode = NMEA_GPGLL_UNKNOWN;
+	}
+	valid = nmeaFieldToUint(sentence, 2, &active->fixMode) || nmeaFieldLength(sentence, 2) == 0;
+
+	// Build the bitmap from the twelve ID fields
+	for (nmeaCount = 0; nmeaCount < NMEA_GPGSA_WORDS; nmeaCount++)
+	{
+		active->satellitesUsed[nmeaCount] = 0;
+	}
+	active->usedCount = 0;
+
+	for (nmeaCount = 3; nmeaCount <= 14; nmeaCount++)
+	{
+		if (nmeaFieldLength(sentence, nmeaCount) == 0)
 		{
-			geographicPos.status =  NMEA_GPGLL_INVALID;
+			continue;
 		}
-		if (geographicPos.longitude.gpsDegrees > 90)
+
+		if (!nmeaFieldToUint(sentence, nmeaCount, &nmeaTemp1))
 		{
-			geographicPos.status =  NMEA_GPGLL_INVALID;
+			context->stats.malformed++;
+			NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GSA_PRN, nmeaCount, 0, 0, 0);
+			continue;
 		}
-		if (geographicPos.longitude.gpsMinutes > 59 || geographicPos.longitude.gpsMinutes < 0)
+
+		// Beyond the bitmap there is no telling a repeat, just count it
+		if (nmeaTemp1 > NMEA_GPGSA_MAXPRN)
 		{
-			geographicPos.status =  NMEA_GPGLL_INVALID;
+			active->usedCount++;
 		}
-		if (geographicPos.longitude.gpsSubMinutes > 9999 || geographicPos.longitude.gpsSubMinutes < 0)
+		// Only count each one once, in case a receiver repeats one
+		else if (!NMEA_GPGSA_USED(active, nmeaTemp1))
 		{
-			geographicPos.status =  NMEA_GPGLL_INVALID;
+			active->satellitesUsed[nmeaTemp1 >> 4] |= (1U << (nmeaTemp1 & 15));
+			active->usedCount++;
 		}
 	}
-*/
-	// Actually, by the time we get here we should be pointing to 
-	// A_ETX. The calling function needs this marker to finish
-	// his do-while loop
-#ifdef OUTPUT_GPGLL_DATA
-	outputGPGLL();
+
+	// DOPs to two places, empty ones read as 0
+	for (nmeaCount = 0; nmeaCount < 3; nmeaCount++)
+	{
+		valid &= nmeaFieldToNumber(sentence, 15 + nmeaCount, 2, &nmeaDop[nmeaCount]) ||
+				 nmeaFieldLength(sentence, 15 + nmeaCount) == 0;
+	}
+	active->pdop = (Uint16)nmeaDop[0];
+	active->hdop = (Uint16)nmeaDop[1];
+	active->vdop = (Uint16)nmeaDop[2];
+
+	if (!valid)
+	{
+		context->stats.malformed++;
+		return 0;
+	}
+	context->activeSats = gsa;
+
+#ifdef OUTPUT_GPGSA_DATA
+	outputGPGSA(context);
+#endif
+
+	return NMEA_EVENT_ACTIVE;
+}
+
+/*----------------------------------------------------------------------------
+ VTG - Track made good and Ground speed, see nmea_dec.h
+
+ Example:
+    $GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*25
+
+ Courses and speeds to two places, NMEA_GPVTG_UNKNOWN if not sent.
+----------------------------------------------------------------------------*/
+Uint16 GPVTG_decode(nmeaContext * context, const nmeaSentenceView * sentence)
+{
+	nmeaVelocityData velocity;				// Read here, kept if every field reads
+	nmeaVelocityData * record;
+	Int32 nmeaFixed;
+	CSLBool valid;
+
+	NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GPVTG, 0, 0, 0, 0);
+
+	record = &velocity;
+	record->constellation = context->constellation;
+	valid = TRUE;
+
+	NMEA_GPVTG_SCHEMA(NMEA_READ_FIELD)
+
+	if (!valid)
+	{
+		context->stats.malformed++;
+		return 0;
+	}
+	context->velocity = velocity;
+
+#ifdef OUTPUT_GPVTG_DATA
+	outputGPVTG(context);
 #endif
+
+	return NMEA_EVENT_VELOCITY;
 }
 
+/*----------------------------------------------------------------------------
+ ZDA - Time & Date, see nmea_dec.h
+
+ Example:
+    $GPZDA,201530.00,04,07,2002,00,00*60
+
+ The date and time go into one epoch value as for RMC, the time is also
+ kept as it was sent.
+----------------------------------------------------------------------------*/
+Uint16 GPZDA_decode(nmeaContext * context, const nmeaSentenceView * sentence)
+{
+	nmeaDateTime dateTime;					// Read here, kept if every field reads
+	nmeaDateTime * record;
+	Int32 nmeaFixed;
+	CSLBool valid;
+
+	NMEA_TRACE(context, NMEA_TRACE_DECODER, NMEA_TRACE_GPZDA, 0, 0, 0, 0);
+
+	record = &dateTime;
+	record->constellation = context->constellation;
+	valid = TRUE;
+
+	NMEA_GPZDA_SCHEMA(NMEA_READ_FIELD)
+
+	if (!valid)
+	{
+		context->stats.malformed++;
+		return 0;
+	}
+	context->dateTime = dateTime;
+
+#ifdef OUTPUT_GPZDA_DATA
+	outputGPZDA(context);
+#endif
+
+	return NMEA_EVENT_TIME;
+}
 
 #ifdef OUTPUT_GPGSV_DATA
-void outputGPGSV(void)
+void outputGPGSV(nmeaContext * context)
 {
 	int i;
 
-	LOG_printf(&logNmeaData, "Satellites in view %d", satellitesInView);
+	LOG_printf(&logNmeaData, "Satellites in table %d", context->sky.count);
 
-	for (i = 0; i < 12; i++)
+	for (i = 0; i < context->sky.count; i++)
 	{
 		{
-			LOG_printf(&logNmeaData, "Satellite No: %d", satsInView[i].satelliteNumber);
-			LOG_printf(&logNmeaData, "Elevation   : %d", satsInView[i].elevation);
-			LOG_printf(&logNmeaData, "Azimuth     : %d", satsInView[i].azimuth);
-			LOG_printf(&logNmeaData, "SNR         : %d", satsInView[i].signalNoiseRatio);
+			LOG_printf(&logNmeaData, "Satellite No: %d", context->sky.prn[i]);
+			LOG_printf(&logNmeaData, "Constellation: %d", context->sky.constellation[i]);
+			LOG_printf(&logNmeaData, "Elevation   : %d", context->sky.elevation[i]);
+			LOG_printf(&logNmeaData, "Azimuth     : %d", context->sky.azimuth[i]);
+			LOG_printf(&logNmeaData, "SNR         : %d", context->sky.signalNoiseRatio[i]);
 			LOG_printf(&logNmeaData, " ");
 		}
 	}
@@ -942,20 +2942,83 @@ void outputGPGSV(void)
 #endif
 
 #ifdef OUTPUT_GPGLL_DATA
-void outputGPGLL(void)
-{
-	LOG_printf(&logNmeaData, "Latitude  Degrees : %d", geographicPos.latitude.gpsDegrees);
-	LOG_printf(&logNmeaData, "Latitude  Minutes : %d.%d", geographicPos.latitude.gpsMinutes, geographicPos.latitude.gpsSubMinutes);
-	LOG_printf(&logNmeaData, "Longitude Degrees : %d", geographicPos.longitude.gpsDegrees);
-	LOG_printf(&logNmeaData, "Longitude Minutes : %d.%d", geographicPos.longitude.gpsMinutes, geographicPos.longitude.gpsSubMinutes);
-	LOG_printf(&logNmeaData, "UTC Time  HH:MM   : %d:%d", geographicPos.utcGpsTime.utcHours, geographicPos.utcGpsTime.utcMinutes);
-	LOG_printf(&logNmeaData, "UTC Time  SS      : %d", geographicPos.utcGpsTime.utcSeconds);
-	LOG_printf(&logNmeaData, "Status      : %c", geographicPos.status);
-	LOG_printf(&logNmeaData, "FAA Mode    : %d", geographicPos.faaMode);
+void outputGPGLL(nmeaContext * context)
+{
+	LOG_printf(&logNmeaData, "Latitude  Degrees : %d", context->geographicPos.latitude.gpsDegrees);
+	LOG_printf(&logNmeaData, "Latitude  Minutes : %d.%d", context->geographicPos.latitude.gpsMinutes, context->geographicPos.latitude.gpsSubMinutes);
+	LOG_printf(&logNmeaData, "Longitude Degrees : %d", context->geographicPos.longitude.gpsDegrees);
+	LOG_printf(&logNmeaData, "Longitude Minutes : %d.%d", context->geographicPos.longitude.gpsMinutes, context->geographicPos.longitude.gpsSubMinutes);
+	LOG_printf(&logNmeaData, "UTC Time  HH:MM   : %d:%d", context->geographicPos.utcGpsTime.utcHours, context->geographicPos.utcGpsTime.utcMinutes);
+	LOG_printf(&logNmeaData, "UTC Time  SS      : %d", context->geographicPos.utcGpsTime.utcSeconds);
+	LOG_printf(&logNmeaData, "Status      : %c", context->geographicPos.status);
+	LOG_printf(&logNmeaData, "FAA Mode    : %d", context->geographicPos.faaMode);
+	LOG_printf(&logNmeaData, " ");
+}
+#endif
+
+#ifdef OUTPUT_GPGGA_DATA
+void outputGPGGA(nmeaContext * context)
+{
+	LOG_printf(&logNmeaData, "Fix Quality       : %d", context->fixData.fixQuality);
+	LOG_printf(&logNmeaData, "Satellites Used   : %d", context->fixData.satellitesUsed);
+	LOG_printf(&logNmeaData, "HDOP x100         : %d", context->fixData.hdop);
+	LOG_printf(&logNmeaData, "Altitude m        : %d", (Int16)(context->fixData.altitude / 100));
+	LOG_printf(&logNmeaData, "Geoid Sep. m      : %d", (Int16)(context->fixData.geoidSeparation / 100));
 	LOG_printf(&logNmeaData, " ");
 }
 #endif
 
+#ifdef OUTPUT_GPRMC_DATA
+void outputGPRMC(nmeaContext * context)
+{
+	LOG_printf(&logNmeaData, "UTC Epoch Hi/Lo   : %x %x", (Uint16)(context->navigationData.utcEpoch >> 16), (Uint16)context->navigationData.utcEpoch);
+	LOG_printf(&logNmeaData, "Speed knots x100  : %d", context->navigationData.speed);
+	LOG_printf(&logNmeaData, "Course x100       : %d", context->navigationData.course);
+	LOG_printf(&logNmeaData, "Status      : %c", context->navigationData.status);
+	LOG_printf(&logNmeaData, " ");
+}
+#endif
+
+#ifdef OUTPUT_GPGSA_DATA
+void outputGPGSA(nmeaContext * context)
+{
+	Uint16 i;
+
+	LOG_printf(&logNmeaData, "Fix Mode          : %d", context->activeSats.fixMode);
+	LOG_printf(&logNmeaData, "Satellites Used   : %d", context->activeSats.usedCount);
 
+	for (i = 0; i <= NMEA_GPGSA_MAXPRN; i++)
+	{
+		if (NMEA_GPGSA_USED(&context->activeSats, i))
+		{
+			LOG_printf(&logNmeaData, "Used PRN    : %d", i);
+		}
+	}
+
+	LOG_printf(&logNmeaData, "PDOP x100         : %d", context->activeSats.pdop);
+	LOG_printf(&logNmeaData, "HDOP x100         : %d", context->activeSats.hdop);
+	LOG_printf(&logNmeaData, "VDOP x100         : %d", context->activeSats.vdop);
+	LOG_printf(&logNmeaData, " ");
+}
+#endif
 
+#ifdef OUTPUT_GPVTG_DATA
+void outputGPVTG(nmeaContext * context)
+{
+	LOG_printf(&logNmeaData, "Course x100       : %d", context->velocity.course);
+	LOG_printf(&logNmeaData, "Course mag x100   : %d", context->velocity.courseMagnetic);
+	LOG_printf(&logNmeaData, "Speed knots x100  : %d", context->velocity.speedKnots);
+	LOG_printf(&logNmeaData, "Speed km/h x100   : %d", context->velocity.speedKph);
+	LOG_printf(&logNmeaData, " ");
+}
+#endif
 
+#ifdef OUTPUT_GPZDA_DATA
+void outputGPZDA(nmeaContext * context)
+{
+	LOG_printf(&logNmeaData, "UTC Epoch Hi/Lo   : %x %x", (Uint16)(context->dateTime.utcEpoch >> 16), (Uint16)context->dateTime.utcEpoch);
+	LOG_printf(&logNmeaData, "Zone hours        : %d", context->dateTime.zoneHours);
+	LOG_printf(&logNmeaData, "Zone minutes      : %d", context->dateTime.zoneMinutes);
+	LOG_printf(&logNmeaData, " ");
+}
+#endif
@@ -18,17 +18,62 @@
 
 /*----------------------------------------------------------------------------
 
- GP
+ GP - GPS, GL - GLONASS, GA - Galileo, GB/BD - BeiDou, QZ - QZSS,
+ GN - a solution from more than one of them
 
 ----------------------------------------------------------------------------*/
 #define NMEA_GP		0x4750
+#define NMEA_GL		0x474C
+#define NMEA_GA		0x4741
+#define NMEA_GB		0x4742
+#define NMEA_BD		0x4244
+#define NMEA_QZ		0x515A
+#define NMEA_GN		0x474E
 
 /*----------------------------------------------------------------------------
- Declare the possible three postfix characters
+ Constellations
 
- These values are made of the three chars added to one another in an Uint16
+ Each decoded record is tagged with the constellation its talker belongs
+ to. A context only decodes sentences from talkers whose bit is set in
+ its talkerMask, anything else is dropped as soon as the address is read.
+----------------------------------------------------------------------------*/
+#define NMEA_CONSTELLATION_GPS		0
+#define NMEA_CONSTELLATION_GLONASS	1
+#define NMEA_CONSTELLATION_GALILEO	2
+#define NMEA_CONSTELLATION_BEIDOU	3
+#define NMEA_CONSTELLATION_QZSS		4
+#define NMEA_CONSTELLATION_MULTI	5			// GN
+#define NMEA_CONSTELLATION_OTHER	6			// Any other talker
+#define NMEA_CONSTELLATIONS			7
+
+#define NMEA_TALKER_MASK(constellation)	(1U << (constellation))
+#define NMEA_TALKER_ALL				0x007F
+
+/*----------------------------------------------------------------------------
+ Declare the possible five character addresses
+
+ Each sentence is identified by its full address, the two prefix chars
+ followed by the three postfix chars. NMEA_ADDRESS() packs the five chars
+ six bits at a time into an Uint32 (char - 0x20, so ' ' to '_').
+
+ Every upper case letter and digit has its own six bit code, so two
+ different addresses can never produce the same value. Anything outside
+ that range is reported as NMEA_ADDRESS_INVALID, which no real address
+ can equal as it uses the top two bits.
 
 ----------------------------------------------------------------------------*/
+#define NMEA_ADDRESS_CHAR(c)	(((Uint32)(c) - 0x20) & 0x3F)
+#define NMEA_ADDRESS(a, b, c, d, e)	\
+	((NMEA_ADDRESS_CHAR(a) << 24) | (NMEA_ADDRESS_CHAR(b) << 18) | \
+	 (NMEA_ADDRESS_CHAR(c) << 12) | (NMEA_ADDRESS_CHAR(d) << 6) | \
+	  NMEA_ADDRESS_CHAR(e))
+#define NMEA_ADDRESS_INVALID	0xFFFFFFFF
+
+// The three postfix chars alone, i.e. the address with a blank talker.
+// A decoder registered against one of these gets that sentence from
+// any talker (see nmeaFindDecoder())
+#define NMEA_FORMATTER(c, d, e)	NMEA_ADDRESS(' ', ' ', c, d, e)
+#define NMEA_FORMATTER_MASK		0x0003FFFF
 
 /*----------------------------------------------------------------------------
 
@@ -59,7 +104,7 @@ Example:
 
 ----------------------------------------------------------------------------*/
 
-#define NMEA_GPGSV		0x00F0
+#define NMEA_GPGSV		NMEA_ADDRESS('G','P','G','S','V')
 
 
 
@@ -85,7 +130,7 @@ Introduced in NMEA 3.0.
 
 ----------------------------------------------------------------------------*/
 
-#define NMEA_GPGLL				0x00DF
+#define NMEA_GPGLL				NMEA_ADDRESS('G','P','G','L','L')
 // Define valid and invalid using ascii chars
 #define NMEA_GPGLL_VALID		A_A
 #define NMEA_GPGLL_INVALID		A_V
@@ -93,6 +138,7 @@ Introduced in NMEA 3.0.
 // Define FAA Mode
 #define NMEA_GPGLL_UNKNOWN		0x0000
 // This says how many values we support after decimal point in lat and long
+// (gpsCoord only, the E7 values keep up to seven)
 #define NMEA_GPGLL_PRECISION	4
 
 /*----------------------------------------------------------------------------
@@ -136,7 +182,13 @@ Time, Position and fix related data for a GPS receiver.
 
 ----------------------------------------------------------------------------*/
 
-#define NMEA_GPGGA		0x00CF
+#define NMEA_GPGGA				NMEA_ADDRESS('G','P','G','G','A')
+// Fix quality (field 6)
+#define NMEA_GPGGA_NOFIX		0
+#define NMEA_GPGGA_GPS			1
+#define NMEA_GPGGA_DGPS			2
+// Age and station when DGPS is not in use (empty fields)
+#define NMEA_GPGGA_NODGPS		0xFFFF
 
 
 /*----------------------------------------------------------------------------
@@ -168,7 +220,13 @@ or an elevation mask test failed.
 
 ----------------------------------------------------------------------------*/
 
-#define NMEA_GPRMC		0x00E2
+#define NMEA_GPRMC				NMEA_ADDRESS('G','P','R','M','C')
+// Status uses the same ascii chars as GPGLL
+#define NMEA_GPRMC_VALID		A_A
+#define NMEA_GPRMC_INVALID		A_V
+// No date or time yet (utcEpoch) and no magnetic variation sent
+#define NMEA_GPRMC_NOTIME		0
+#define NMEA_GPRMC_NOVARIATION	0x7FFF
 
 
 /*----------------------------------------------------------------------------
@@ -204,26 +262,235 @@ as sure of my position as I was a couple of minutes ago".
 
 ----------------------------------------------------------------------------*/
 
-#define NMEA_GPGSA		0x00DB
+#define NMEA_GPGSA				NMEA_ADDRESS('G','P','G','S','A')
+// Fix mode (field 2)
+#define NMEA_GPGSA_NOFIX		1
+#define NMEA_GPGSA_2D			2
+#define NMEA_GPGSA_3D			3
+// Satellites used are kept as a bitmap with one bit per PRN, PRNs from 0 to
+// NMEA_GPGSA_MAXPRN (GPS 1-32, SBAS 33-64 or 120-158, GLONASS 65-96, QZSS
+// 193-202 in NMEA numbering). IDs above that (e.g. Galileo 301-336 and
+// BeiDou 401-437 from receivers that number them so) are counted in
+// usedCount but have no bit
+#define NMEA_GPGSA_MAXPRN		255
+#define NMEA_GPGSA_WORDS		((NMEA_GPGSA_MAXPRN + 16) / 16)
+// Is satellite prn used in the fix? One bit test
+#define NMEA_GPGSA_USED(gsa, prn)	\
+	((prn) <= NMEA_GPGSA_MAXPRN && ((gsa)->satellitesUsed[(prn) >> 4] & (1U << ((prn) & 15))) != 0)
+
+
+/*----------------------------------------------------------------------------
+
+ VTG - Track made good and Ground speed
+
+          1   2 3   4 5   6 7   8 9
+         |   | |   | |   | |   | |
+ $--VTG,x.x,T,x.x,M,x.x,N,x.x,K,m*hh<CR><LF>
+
+ Field Number: 
+  1) Track Degrees
+  2) T = True
+  3) Track Degrees
+  4) M = Magnetic
+  5) Speed Knots
+  6) N = Knots
+  7) Speed Kilometers Per Hour
+  8) K = Kilometers Per Hour
+  9) FAA mode indicator (NMEA 2.3 and later)
+  10) Checksum
+
+Example:
+    $GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*25
+
+Receivers older than NMEA 2.3 may leave out the T, M, N and K fields,
+that layout isn't decoded.
+
+----------------------------------------------------------------------------*/
+
+#define NMEA_GPVTG				NMEA_ADDRESS('G','P','V','T','G')
+// Any track or speed the receiver left empty
+#define NMEA_GPVTG_UNKNOWN		0xFFFF
+
+
+/*----------------------------------------------------------------------------
+
+ ZDA - Time & Date - UTC, day, month, year and local time zone
+
+          1         2  3  4    5  6  7
+         |         |  |  |    |  |  |
+ $--ZDA,hhmmss.ss,xx,xx,xxxx,xx,xx*hh<CR><LF>
+
+ Field Number: 
+  1) Universal Time Coordinated (UTC)
+  2) Day, 01 to 31
+  3) Month, 01 to 12
+  4) Year (4 digits)
+  5) Local zone description, 00 to +/- 13 hours
+  6) Local zone minutes description, apply same sign as local hours
+  7) Checksum
+
+Example:
+    $GPZDA,201530.00,04,07,2002,00,00*60
+
+----------------------------------------------------------------------------*/
+
+#define NMEA_GPZDA				NMEA_ADDRESS('G','P','Z','D','A')
+
+
+/*----------------------------------------------------------------------------
+ Sentence schemas
+
+ The fixed layout sentences are described by a table of their fields
+ rather than by hand written code. Each row says what kind of value a
+ field holds, which field, which member of the sentence's structure it
+ goes in, and then only what that kind needs:
+
+	F(TIME,      field, member)
+	F(COORD,     field, member, degree digits)
+	F(UINT,      field, member, missing)
+	F(FIXED,     field, member, places, missing)
+	F(FIXED_EW,  field, member, places, missing)
+	F(CHAR,      field, member, missing)
+	F(STATUS,    field, member, missing)
+	F(EPOCH,     field, member, time field)
+	F(EPOCH_DMY, field, member, time field)
+
+ missing is what the member is set to if the field is empty (0 leaves
+ whatever the reader gives). The kinds are
+	TIME		hhmmss.ss into a utcTime
+	COORD		DDMM.MMMM (degree digits 2) or DDDMM.MMMM (3) into the
+				gpsCoord member and, from the same read, member##E7 in
+				1e-7 degrees; the N/S/E/W in the next field sets the sign
+	UINT		Whole number
+	FIXED		[-]x.x as fixed point, with places decimal places
+	FIXED_EW	As FIXED, negative if the next field is W
+	CHAR		A single character, e.g. the FAA mode
+	STATUS		A or V, as NMEA_GPGLL_VALID or _INVALID
+	EPOCH		ddmmyy date with the time in the time field, as seconds
+				since 1970 (NMEA_GPRMC_NOTIME if either is bad)
+	EPOCH_DMY	As EPOCH, with the day, month and 4 digit year in this
+				field and the two after it
+
+ nmea_dec.c expands a table with one direct call per row, in the order
+ given, so there is no table left to walk when a sentence is decoded.
+ Adding a sentence with a fixed layout is a table here, its structure
+ and a few lines of decoder (see GPVTG_decode()).
+
+ GSV and GSA have repeating groups and are still decoded by hand.
+----------------------------------------------------------------------------*/
+#define NMEA_GPGLL_SCHEMA(F) \
+	F(COORD,     1, latitude,          2) \
+	F(COORD,     3, longitude,         3) \
+	F(TIME,      5, utcGpsTime) \
+	F(STATUS,    6, status,            NMEA_GPGLL_ERROR) \
+	F(CHAR,      7, faaMode,           NMEA_GPGLL_UNKNOWN)
+
+#define NMEA_GPGGA_SCHEMA(F) \
+	F(TIME,      1, utcGpsTime) \
+	F(COORD,     2, latitude,          2) \
+	F(COORD,     4, longitude,         3) \
+	F(UINT,      6, fixQuality,        NMEA_GPGGA_NOFIX) \
+	F(UINT,      7, satellitesUsed,    0) \
+	F(FIXED,     8, hdop,              2, 0) \
+	F(FIXED,     9, altitude,          2, 0) \
+	F(FIXED,    11, geoidSeparation,   2, 0) \
+	F(FIXED,    13, dgpsAge,           1, NMEA_GPGGA_NODGPS) \
+	F(UINT,     14, dgpsStation,       NMEA_GPGGA_NODGPS)
+
+#define NMEA_GPRMC_SCHEMA(F) \
+	F(EPOCH,     9, utcEpoch,          1) \
+	F(STATUS,    2, status,            NMEA_GPRMC_INVALID) \
+	F(COORD,     3, latitude,          2) \
+	F(COORD,     5, longitude,         3) \
+	F(FIXED,     7, speed,             2, 0) \
+	F(FIXED,     8, course,            2, 0) \
+	F(FIXED_EW, 10, magneticVariation, 2, NMEA_GPRMC_NOVARIATION) \
+	F(CHAR,     12, faaMode,           NMEA_GPGLL_UNKNOWN)
+
+#define NMEA_GPVTG_SCHEMA(F) \
+	F(FIXED,     1, course,            2, NMEA_GPVTG_UNKNOWN) \
+	F(FIXED,     3, courseMagnetic,    2, NMEA_GPVTG_UNKNOWN) \
+	F(FIXED,     5, speedKnots,        2, NMEA_GPVTG_UNKNOWN) \
+	F(FIXED,     7, speedKph,          2, NMEA_GPVTG_UNKNOWN) \
+	F(CHAR,      9, faaMode,           NMEA_GPGLL_UNKNOWN)
+
+#define NMEA_GPZDA_SCHEMA(F) \
+	F(TIME,      1, utcGpsTime) \
+	F(EPOCH_DMY, 2, utcEpoch,          1) \
+	F(FIXED,     5, zoneHours,         0, 0) \
+	F(FIXED,     6, zoneMinutes,       0, 0)
 
 
 /*----------------------------------------------------------------------------
- This structure defines the contents of a GPGSV message
+ This structure holds the contents of the GPGSV messages, the sky table
+
+ One slot per satellite, for every constellation. Each value has a
+ column of its own, and the satellites are kept packed into slots 0 to
+ count - 1, so anything working on one value (SNR statistics, an
+ elevation mask) reads one dense array:
+
+	for (i = 0; i < sky->count; i++)
+		if (sky->elevation[i] >= mask) ...
+
+ Slots are found from the constellation and PRN through a small hash
+ index, see nmeaSkyFind(). Slots move when a constellation's satellites
+ are cleared out, so don't hold on to a slot number between decodes.
 
  The content is basically:
-	Uint16 Satellite Number
+	Uint16 Satellite Number (PRN)
+	Uint16 Constellation (NMEA_CONSTELLATION_xxx)
 	Int16 Elevation
 	Int16 Azimuth
-	Int16 SNR
+	Int16 SNR (0 if not tracked)
  
  All values are integers
 ----------------------------------------------------------------------------*/
+#define NMEA_SKYSIZE		64					// Satellites in the table
+#define NMEA_SKYINDEXSIZE	128					// Keep this at least twice NMEA_SKYSIZE, and a ^2
+#define NMEA_SKY_NONE		0xFF				// Empty index entry / not found
+
+typedef struct {
+	Uint16 count;								// Satellites in slots 0 to count - 1
+	Uint16 satellitesInView[NMEA_CONSTELLATIONS];	// As each constellation last reported it
+	Uint16 prn[NMEA_SKYSIZE];
+	Uint16 constellation[NMEA_SKYSIZE];
+	Int16  elevation[NMEA_SKYSIZE];
+	Int16  azimuth[NMEA_SKYSIZE];
+	Int16  signalNoiseRatio[NMEA_SKYSIZE];
+	Uint8  index[NMEA_SKYINDEXSIZE];			// Hash of constellation and PRN to slot
+} nmeaSkyTable;
+
+/*----------------------------------------------------------------------------
+ GSV cycle staging
+
+ A constellation's satellites come in a cycle of up to nine GSV messages.
+ They are collected here as they arrive and only go into the sky table,
+ in one go, with the last message of the cycle, so the table never holds
+ half of one cycle and half of the last one.
+
+ The messages must come in order, 1 to the total the first one gave, for
+ one constellation at a time. A message out of order, or one more than
+ NMEA_GSV_TIMEOUT sentences after the message before it, drops what has
+ been collected (counted in partialCycles) and the cycle is lost. The
+ timeout is counted in sentences rather than time, so a capture decoded
+ faster than it was recorded behaves the same as the receiver live.
+----------------------------------------------------------------------------*/
+#define NMEA_GSV_MESSAGES	9					// Most messages in a cycle (one digit)
+#define NMEA_GSV_STAGESIZE	(NMEA_GSV_MESSAGES * 4)	// Four satellites a message
+#define NMEA_GSV_TIMEOUT	8					// Most sentences from one message to the next
+
 typedef struct {
-	Uint16 satelliteNumber;
-	Int16  elevation;
-	Int16  azimuth;
-	Int16  signalNoiseRatio;
-} nmeaSatelliteInView;
+	Uint16 messages;							// Messages in the cycle, 0 if none collecting
+	Uint16 nextMessage;							// Message number wanted next
+	Uint16 constellation;
+	Uint16 lastSentence;						// context->sentences at the last message
+	Uint16 satellitesInView;
+	Uint16 count;								// Satellites collected so far
+	Uint16 prn[NMEA_GSV_STAGESIZE];
+	Int16  elevation[NMEA_GSV_STAGESIZE];
+	Int16  azimuth[NMEA_GSV_STAGESIZE];
+	Int16  signalNoiseRatio[NMEA_GSV_STAGESIZE];
+} nmeaGsvStage;
 
 /*----------------------------------------------------------------------------
  This structure defines the contents of a GPGLL message
@@ -237,14 +504,22 @@ typedef struct {
 		(format DDDMMMMMM, where last four values are <1 of a minute)
 	Int16 Longitude Minutes
 	Int16 Longitude SubMinutes
+	Int32 Latitude and Longitude in 1e-7 degrees (+ve = North/East)
 	Uint16 UTC Time Hours
-		(format HHMMSS (we ignore parts of seconds))
+		(format HHMMSS (we ignore parts of seconds), NMEA_UTC_NOTIME
+		if the receiver sent no time)
 	Uint16 UTC Time Minutes
 	Uint16 UTC Time Seconds
 	Uint16 Status
 	Uint16 FAA Mode
+	Uint16 Constellation (NMEA_CONSTELLATION_xxx)
  
  All values are integers
+
+ The E7 values are the same position as one signed number each, so they
+ can be used as they are without putting degrees and minutes back
+ together. 1e-7 degrees is about 1cm, and +/-180 degrees fits in an
+ Int32, so nothing the receiver sends is lost.
 ----------------------------------------------------------------------------*/
 typedef struct {
 	Int16 utcHours;
@@ -252,6 +527,8 @@ typedef struct {
 	Int16 utcSeconds;
 } utcTime;
 
+#define NMEA_UTC_NOTIME		(-1)			// utcHours for an empty time field
+
 typedef struct {
 	Int16 gpsDegrees;
 	Int16 gpsMinutes;
@@ -261,7 +538,732 @@ typedef struct {
 typedef struct {
 	gpsCoord	latitude;
 	gpsCoord	longitude;
+	Int32		latitudeE7;
+	Int32		longitudeE7;
 	utcTime		utcGpsTime;
 	Uint16 		status;
 	Uint16 		faaMode;
+	Uint16		constellation;
 } nmeaGeographicPosition;
+
+/*----------------------------------------------------------------------------
+ This structure defines the contents of a GPGGA message
+
+ The content is basically:
+	utcTime UTC Time, as GPGLL
+	gpsCoord Latitude and Longitude, as GPGLL
+	Int32 Latitude and Longitude in 1e-7 degrees, as GPGLL
+	Uint16 Fix Quality (NMEA_GPGGA_NOFIX, _GPS, _DGPS etc.)
+	Uint16 Satellites Used
+	Uint16 HDOP (x100, e.g. 0.9 is 90)
+	Int32 Altitude above mean-sea-level (cm)
+	Int32 Geoidal Separation (cm)
+	Uint16 DGPS Age (x10 seconds, NMEA_GPGGA_NODGPS if none)
+	Uint16 DGPS Station ID (NMEA_GPGGA_NODGPS if none)
+	Uint16 Constellation (NMEA_CONSTELLATION_xxx)
+
+ All values are integers, there is no FPU
+----------------------------------------------------------------------------*/
+typedef struct {
+	utcTime		utcGpsTime;
+	gpsCoord	latitude;
+	gpsCoord	longitude;
+	Int32		latitudeE7;
+	Int32		longitudeE7;
+	Uint16		fixQuality;
+	Uint16		satellitesUsed;
+	Uint16		hdop;
+	Int32		altitude;
+	Int32		geoidSeparation;
+	Uint16		dgpsAge;
+	Uint16		dgpsStation;
+	Uint16		constellation;
+} nmeaFixData;
+
+/*----------------------------------------------------------------------------
+ This structure defines the contents of a GPRMC message
+
+ The content is basically:
+	Uint32 UTC Date and Time as seconds since 1st Jan 1970
+		(NMEA_GPRMC_NOTIME until the receiver knows both)
+	gpsCoord Latitude and Longitude, as GPGLL
+	Int32 Latitude and Longitude in 1e-7 degrees, as GPGLL
+	Uint16 Speed over ground (knots x100)
+	Uint16 Course over ground (degrees true x100)
+	Int16 Magnetic Variation (degrees x100, +ve = East, -ve = West,
+		NMEA_GPRMC_NOVARIATION if not sent)
+	Uint16 Status
+	Uint16 FAA Mode
+	Uint16 Constellation (NMEA_CONSTELLATION_xxx)
+
+ All values are integers. The whole fix is 36 bytes (18 words on the
+ C55x), so reading one on a host build is a single 64 byte cache line.
+ The host build checks it still fits.
+----------------------------------------------------------------------------*/
+typedef struct {
+	Uint32		utcEpoch;
+	Int32		latitudeE7;
+	Int32		longitudeE7;
+	gpsCoord	latitude;
+	gpsCoord	longitude;
+	Uint16		speed;
+	Uint16		course;
+	Int16		magneticVariation;
+	Uint16		status;
+	Uint16		faaMode;
+	Uint16		constellation;
+} nmeaNavigationData;
+
+#ifdef NMEA_HOST
+_Static_assert(sizeof(nmeaNavigationData) <= 64, "nmeaNavigationData no longer fits in one cache line");
+#endif
+
+/*----------------------------------------------------------------------------
+ This structure defines the contents of a GPGSA message
+
+ The content is basically:
+	Uint16 Bitmap of the satellites used in the fix, one bit per PRN
+		(see NMEA_GPGSA_USED())
+	Uint16 How many satellites are used, including any numbered above
+		NMEA_GPGSA_MAXPRN
+	Uint16 PDOP, HDOP and VDOP (x100, e.g. 1.5 is 150)
+	Uint16 Selection Mode (A or M)
+	Uint16 Fix Mode (NMEA_GPGSA_NOFIX, _2D, _3D)
+	Uint16 Constellation (NMEA_CONSTELLATION_xxx)
+
+ All values are integers
+----------------------------------------------------------------------------*/
+typedef struct {
+	Uint16		satellitesUsed[NMEA_GPGSA_WORDS];
+	Uint16		usedCount;
+	Uint16		pdop;
+	Uint16		hdop;
+	Uint16		vdop;
+	Uint16		selectionMode;
+	Uint16		fixMode;
+	Uint16		constellation;
+} nmeaActiveSatellites;
+
+/*----------------------------------------------------------------------------
+ This structure defines the contents of a GPVTG message
+
+ The content is basically:
+	Uint16 Course over ground (degrees true x100)
+	Uint16 Course over ground (degrees magnetic x100)
+	Uint16 Speed over ground (knots x100)
+	Uint16 Speed over ground (km/h x100)
+	Uint16 FAA Mode
+	Uint16 Constellation (NMEA_CONSTELLATION_xxx)
+
+ Any course or speed not sent is NMEA_GPVTG_UNKNOWN
+----------------------------------------------------------------------------*/
+typedef struct {
+	Uint16		course;
+	Uint16		courseMagnetic;
+	Uint16		speedKnots;
+	Uint16		speedKph;
+	Uint16		faaMode;
+	Uint16		constellation;
+} nmeaVelocityData;
+
+/*----------------------------------------------------------------------------
+ This structure defines the contents of a GPZDA message
+
+ The content is basically:
+	Uint32 UTC Date and Time as seconds since 1st Jan 1970, as GPRMC
+	utcTime UTC Time, as GPGLL
+	Int16 Local Zone Hours and Minutes, as sent
+	Uint16 Constellation (NMEA_CONSTELLATION_xxx)
+
+ All values are integers
+----------------------------------------------------------------------------*/
+typedef struct {
+	Uint32		utcEpoch;
+	utcTime		utcGpsTime;
+	Int16		zoneHours;
+	Int16		zoneMinutes;
+	Uint16		constellation;
+} nmeaDateTime;
+
+/*----------------------------------------------------------------------------
+ This structure holds one epoch, every sentence of a fix merged together
+
+ A receiver sends GGA, RMC, GSA, GLL, VTG and ZDA for the same instant.
+ The epoch assembler gathers what they give into one record and reports
+ it as NMEA_EVENT_EPOCH once, so a task after the fix wakes once per fix
+ rather than once per sentence. GSV isn't part of it, the sky table
+ already changes once per GSV cycle (see GSV cycle staging).
+
+ The content is basically:
+	Uint32 UTC Date and Time as seconds since 1st Jan 1970 (RMC or ZDA)
+	utcTime UTC Time (GGA, GLL or ZDA)
+	Int32 Latitude and Longitude in 1e-7 degrees (GGA, RMC or GLL)
+	Int32 Altitude above mean-sea-level (cm, GGA)
+	Uint16 Fix Quality (GGA), Status (RMC or GLL), Fix Mode (GSA)
+	Uint16 Speed over ground (knots x100) and Course (degrees x100)
+		(RMC or VTG)
+	Uint16 PDOP, HDOP and VDOP (x100, GSA, or HDOP from GGA)
+	Uint16 Satellites used, and a bitmap of them for each constellation
+		as NMEA_GPGSA_USED() (every GSA of the epoch, or the count from GGA)
+	Uint16 The NMEA_EVENT_xxx bits of the sentences it was made from
+
+ Where two sentences give the same value the later one wins, except that
+ GSA's DOPs and satellites win over GGA's. Anything none of the epoch's
+ sentences gave is 0, check events.
+
+ Sentences are grouped by their UTC time. An epoch is complete once it
+ has a sentence of every type the receiver has been seen to send in an
+ epoch, and as many GSAs, and is reported straight away. Otherwise its
+ deadline is the first sentence of the next epoch: one with a different
+ time, or a second GGA, RMC, GLL, VTG or ZDA (receivers faster than 1Hz
+ send times with fractions of a second, which are ignored). A GSA, which
+ comes once per constellation, and a sentence with an empty time field
+ are taken into whichever epoch is open.
+----------------------------------------------------------------------------*/
+#define NMEA_EPOCH_NOTIME	(-1L)				// Epoch whose time isn't known yet
+
+typedef struct {
+	Uint32		utcEpoch;
+	utcTime		utcGpsTime;
+	Int32		latitudeE7;
+	Int32		longitudeE7;
+	Int32		altitude;
+	Uint16		fixQuality;
+	Uint16		status;
+	Uint16		fixMode;
+	Uint16		speed;
+	Uint16		course;
+	Uint16		pdop;
+	Uint16		hdop;
+	Uint16		vdop;
+	Uint16		usedCount;
+	Uint16		satellitesUsed[NMEA_CONSTELLATIONS][NMEA_GPGSA_WORDS];
+	Uint16		events;
+} nmeaEpochFix;
+
+typedef struct {
+	nmeaEpochFix fix;							// The epoch being put together
+	Int32 time;									// Its UTC time as seconds of the day
+	Uint16 expected;							// Sentences an epoch has been seen to have
+	Uint16 activeCount;							// GSAs in the epoch being put together
+	Uint16 expectedActive;						// Most GSAs an epoch has been seen to have
+} nmeaEpochStage;
+
+/*----------------------------------------------------------------------------
+ Storage type for the characters in the circular buffer
+
+ NMEA is plain 7-bit ASCII. Define NMEA_PACKED_RING on byte addressed
+ targets to keep one character per byte. Word addressed targets such as
+ the C55x have no 8-bit type and keep one character per Uint16.
+
+ The ASCII codes in ascii_16.h all fit in 8 bits, so they compare the
+ same against either layout.
+
+ Packing only halves the RAM a character takes, so the packed ring holds
+ twice the sentences of the word ring in the same RAM, six rather than
+ three. A board that needs more headroom for GSV bursts can build with a
+ bigger NMEABUFFSIZE, e.g. -DNMEABUFFSIZE=1024 holds twelve, four times
+ the word ring, for twice its RAM.
+----------------------------------------------------------------------------*/
+#ifdef NMEA_PACKED_RING
+typedef Uint8 nmeaChar;
+#ifndef NMEABUFFSIZE
+#define NMEABUFFSIZE		512				// Same RAM as the word ring, holds six
+#endif										// complete (82 char) messages
+#else
+typedef Uint16 nmeaChar;
+#ifndef NMEABUFFSIZE
+#define NMEABUFFSIZE		256				// Holds three complete (82 char) messages
+#endif
+#endif
+											// keep a ^2 - circular buffer!!!
+#if (NMEABUFFSIZE & (NMEABUFFSIZE - 1)) != 0 || NMEABUFFSIZE > 0x8000
+#error "NMEABUFFSIZE must be a power of two no bigger than 0x8000"
+#endif
+#define NMEASENTBUFFSIZE	8				// How many framed sentences we can queue
+											// keep a ^2 - circular buffer!!!
+#define UARTBUFFSIZE		64				// Most chars processNmea() gets at once,
+											// dependent on UART settings
+
+/*----------------------------------------------------------------------------
+ This structure describes one framed sentence sitting in the circular buffer
+
+ The content is basically:
+	nmeaChar * Text (the circular buffer holding the sentence)
+	Uint16 Start (where the first address character is in nmeaBuffer,
+		free running, masked when read)
+	Uint16 Readable (chars that can be read from Start on in one run,
+		to the end of the buffer, whether or not they are this sentence)
+	Uint16 Length (characters between the '$' and the '*')
+	Uint16 Status (checksum result, see NMEA_SENTENCE_xxx)
+	Uint16 Field Count (fields in the sentence, the address is field 0)
+	Uint8  Field Offsets (where each field starts, from the first char)
+
+ The buffer only holds the sentence text. The checksum flag and the end
+ of the sentence are kept here rather than as markers in the text.
+
+ processNmea() notes where every comma is as it checksums the sentence,
+ so field N starts at field[N] and ends one before field[N + 1]. Only the
+ first NMEA_MAXFIELDS fields are indexed, which covers a full GSV. No
+ message we frame is longer than NMEA_MAXLENGTH, so the offsets fit in
+ a Uint8.
+
+ The decoders read the sentence in place through this view. The wrap at
+ the end of the circular buffer is handled when a character is read, so
+ nothing has to be copied out of the buffer first. processNmea() only ever
+ writes ahead of the sentences it has already handed over, so the view
+ stays valid until decodeNmea() moves past it.
+----------------------------------------------------------------------------*/
+#define NMEA_SENTENCE_GOOD		0x0000
+#define NMEA_SENTENCE_BADCHKSUM	0x0001
+
+#define NMEA_MAXFIELDS			24
+#define NMEA_MAXLENGTH			120
+
+typedef struct {
+	const nmeaChar * text;
+	Uint16 start;
+	Uint16 readable;
+	Uint16 length;
+	Uint16 status;
+	Uint16 fieldCount;
+	Uint8  field[NMEA_MAXFIELDS + 1];
+} nmeaSentenceView;
+
+/*----------------------------------------------------------------------------
+ Sentence queue between processNmea() and decodeNmea()
+
+ A single producer, single consumer queue. Only processNmea() writes head
+ and dataHead, only decodeNmea() writes tail and dataTail. The indexes run
+ freely and are masked when used, so with the sizes kept a power of two
+ head - tail is always the number of queued sentences (and dataHead -
+ dataTail the characters held), even across the Uint16 wrap.
+
+ processNmea() fills in entry[head] while it frames the sentence, then
+ publishes it by moving head on. decodeNmea() reads entry[tail] and the
+ text it points at, then hands both back by moving tail and dataTail on.
+ A sentence that won't fit (queue or buffer full) is dropped and counted
+ in overruns, rather than overwriting one that hasn't been decoded yet.
+
+ On the DSP the two sides are a HWI-driven SWI and a lower priority SWI
+ on one core, so volatile indexes are enough. On a host build the two
+ sides may be threads on different cores, so the publish and release are
+ fenced, and the producer and consumer indexes sit in different cache
+ lines.
+----------------------------------------------------------------------------*/
+#ifdef NMEA_HOST
+#define NMEA_RELEASE()		__atomic_thread_fence(__ATOMIC_RELEASE)
+#define NMEA_ACQUIRE()		__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define NMEA_CACHE_ALIGN	__attribute__((aligned(64)))
+#else
+#define NMEA_RELEASE()
+#define NMEA_ACQUIRE()
+#define NMEA_CACHE_ALIGN
+#endif
+
+typedef struct {
+	// Producer (processNmea) side
+	volatile Uint16 head NMEA_CACHE_ALIGN;	// Next entry to fill
+	Uint16 dataHead;						// Next character to write in the buffer
+	Uint32 overruns;						// Sentences dropped for want of room
+	// Consumer (decodeNmea) side
+	volatile Uint16 tail NMEA_CACHE_ALIGN;	// Next entry to decode
+	volatile Uint16 dataTail;				// First character still in use
+	nmeaSentenceView entry[NMEASENTBUFFSIZE] NMEA_CACHE_ALIGN;
+} nmeaSentenceQueue;
+
+nmeaSentenceView * nmeaQueueClaim(nmeaSentenceQueue * queue);
+CSLBool nmeaQueueHasRoom(nmeaSentenceQueue * queue, Uint16 dataIn);
+void nmeaQueuePublish(nmeaSentenceQueue * queue);
+nmeaSentenceView * nmeaQueuePeek(nmeaSentenceQueue * queue);
+void nmeaQueueRelease(nmeaSentenceQueue * queue);
+
+/*----------------------------------------------------------------------------
+ UART input
+
+ uartHwi and processNmea() share two buffers, ping-pong fashion. The HWI
+ (or a DMA channel) fills one while processNmea() frames the other where
+ it lies, and each hands a buffer to the other when done with it, so the
+ chars go from the buffer the UART filled into the context's ring with
+ no copy in between.
+
+ The HWI side, once per buffer:
+	buffer = nmeaUartFillBuffer(&nmeaUartInput);
+	if (buffer != NULL)
+	{
+		(put up to UARTBUFFSIZE chars in buffer)
+		nmeaUartHandOver(&nmeaUartInput, count);
+		SWI_post(&processNmeaSwi);
+	}
+	else
+		(read the chars out of the UART and drop them)
+ nmeaUartFillBuffer() returns NULL (and counts it in dropped) while both
+ buffers are still waiting for processNmea(), and the HWI then skips the
+ hand-over. Should it hand over anyway, nmeaUartHandOver() ignores it
+ rather than overwrite a count processNmea() hasn't framed yet. A DMA
+ ping-pong does the same from its block complete interrupt, pointing
+ the next block at the buffer nmeaUartFillBuffer() returns.
+
+ processNmea() frames every buffer handed over since it last ran, oldest
+ first, and hands each back by zeroing its count. Only the HWI changes
+ fill and only processNmea() changes drain; count is the hand-over.
+----------------------------------------------------------------------------*/
+typedef struct {
+	nmeaChar data[2][UARTBUFFSIZE];
+	volatile Uint16 count[2];				// Chars handed over, 0 while the HWI has it
+	Uint16 fill;							// Buffer the HWI fills next
+	Uint16 drain;							// Buffer processNmea() frames next
+	Uint32 dropped;							// Times no buffer was free to fill
+} nmeaUartBuffers;
+
+extern nmeaUartBuffers nmeaUartInput;		// The board's UART, for processNmea()
+
+nmeaChar * nmeaUartFillBuffer(nmeaUartBuffers * input);
+void nmeaUartHandOver(nmeaUartBuffers * input, Uint16 count);
+
+/*----------------------------------------------------------------------------
+ Statistics
+
+ Counters kept by each context, each a plain increment where it happens.
+ The framer (processNmea) side counts
+	Discarded - chars skipped while looking for a '$', including the
+		rest of any sentence dropped as an overrun and the CR LF after
+		each checksum
+	Filtered - sentences dropped for not being on the accept list, the
+		rest of their chars are counted as discarded
+	Over Long - sentences dropped for running past NMEA_MAXLENGTH chars
+		without a '*', the rest of their chars are counted as discarded
+ and the decoder (decodeNmea) side
+	Decoded - sentences decoded, by the NMEA_EVENT_xxx bit their decoder
+		returned: [0] GLL, [1] GSV, [2] GGA, [3] RMC, [4] GSA, [5] VTG,
+		[6] ZDA for the decoders in nmea_dec.c, and [7] epochs
+	Checksum Errors - sentences with a bad checksum
+	Talker Drops - sentences from talkers not in talkerMask
+	Unknown Sentences - sentences nothing is registered to decode
+	Unsubscribed - sentences skipped unread because nothing polls or
+		subscribes to what their decoder reports
+	Malformed - sentences dropped for a field that is there but can't
+		be read, and GSA satellite IDs skipped for the same reason
+	Partial Cycles - GSV cycles dropped before their last message
+ GSV is counted in decoded[1] once per complete cycle, not per message.
+ Overruns (sentences dropped for want of room) is kept by the queue and
+ only filled in by nmeaSnapshotStats().
+
+ nmeaSnapshotStats() copies the lot with the SWIs disabled, so on the DSP
+ the copy is consistent. On a host build where the two sides run on
+ different threads each counter is read whole, but the set may be taken
+ part way through a sentence.
+----------------------------------------------------------------------------*/
+#define NMEA_STATS_TYPES		8			// Event bits counted in decoded[]
+
+typedef struct {
+	// Framer side
+	Uint32 discarded;
+	Uint32 filtered;
+	Uint32 overLong;
+	// Decoder side
+	Uint32 decoded[NMEA_STATS_TYPES] NMEA_CACHE_ALIGN;
+	Uint32 checksumErrors;
+	Uint32 talkerDrops;
+	Uint32 unknownSentences;
+	Uint32 unsubscribed;
+	Uint32 malformed;
+	Uint32 partialCycles;
+	// From the queue, snapshots only
+	Uint32 overruns;
+} nmeaStats;
+
+/*----------------------------------------------------------------------------
+ Trace ring
+
+ Built with NMEA_VERBOSE, the framer and decoders note what they would
+ have logged as a binary entry rather than calling LOG_printf() there and
+ then: the time, an event ID and up to four raw Uint16 args, a handful of
+ stores. nmeaDrainTrace(), run from something of low priority (an IDL
+ function or a TSK), formats them to logNmea later, oldest first, with
+ the format in nmeaTraceFormat[] for the event. LOG_printf() only takes
+ two args, so only arg[0] and arg[1] are printed.
+
+ Each context has two rings, one written only by processNmea() and one
+ only by decodeNmea(), so a writer never has to lock out the other. Each
+ is a power of two of entries, and head runs freely. A writer never
+ waits for the drain: if it gets more than NMEA_TRACE_SIZE ahead the
+ oldest entries are overwritten, and the drain reports how many it
+ missed.
+
+ The time is CLK_getltime() (system ticks) on the DSP, which is only a
+ load. The entries are plain words, so a memory dump of the rings can be
+ decoded on a PC against the table below.
+----------------------------------------------------------------------------*/
+#define NMEA_TRACE_SIZE			32			// Entries in each ring, keep a ^2!!!
+#define NMEA_TRACE_FRAMER		0			// Ring written by processNmea()
+#define NMEA_TRACE_DECODER		1			// Ring written by decodeNmea()
+
+											// Event (arg[0], arg[1])
+#define NMEA_TRACE_CHECKSUM		0			// Framer checksum bad (expected, got)
+#define NMEA_TRACE_BADSENTENCE	1			// Decoder given a bad sentence (first char, status)
+#define NMEA_TRACE_UNKNOWN		2			// No decoder for the sentence
+#define NMEA_TRACE_GPGSV		3			// GSV decoded
+#define NMEA_TRACE_GSV_NUMBER	4			// GSV without a message number
+#define NMEA_TRACE_SKY_FULL		5			// No room in the sky table (constellation, PRN)
+#define NMEA_TRACE_GPGLL		6			// GLL decoded
+#define NMEA_TRACE_GPGGA		7			// GGA decoded
+#define NMEA_TRACE_GPRMC		8			// RMC decoded
+#define NMEA_TRACE_GPGSA		9			// GSA decoded
+#define NMEA_TRACE_GSA_PRN		10			// GSA satellite ID unreadable (field)
+#define NMEA_TRACE_GPVTG		11			// VTG decoded
+#define NMEA_TRACE_GPZDA		12			// ZDA decoded
+#define NMEA_TRACE_GSV_DROPPED	13			// Partial GSV cycle dropped (messages collected, total)
+#define NMEA_TRACE_TALKER		14			// Talker not in talkerMask (its two chars)
+#define NMEA_TRACE_EVENTS		15
+
+typedef struct {
+	Uint32 time;							// CLK_getltime() when it was written
+	Uint16 event;							// NMEA_TRACE_xxx
+	Uint16 arg[4];
+} nmeaTraceEntry;
+
+typedef struct {
+	volatile Uint16 head NMEA_CACHE_ALIGN;	// Next entry to write
+	Uint16 tail;							// Next entry for nmeaDrainTrace()
+	Uint32 lost;							// Entries overwritten before they were drained
+	nmeaTraceEntry entry[NMEA_TRACE_SIZE];
+} nmeaTraceRing;
+
+extern const char * const nmeaTraceFormat[NMEA_TRACE_EVENTS];
+
+/*----------------------------------------------------------------------------
+ Subscriptions
+
+ Rather than polling the context after every nmeaDecodeContext(), code
+ can subscribe a callback to the NMEA_EVENT_xxx bits it cares about. Once
+ a sentence is decoded the callback is called for each of its bits with
+ the record the decoder just wrote (nmeaEventRecord()), e.g. an
+ nmeaGeographicPosition for NMEA_EVENT_POSITION, and the arg it was
+ subscribed with. Subscribe the same callback more than once with
+ different args if need be; nmeaSubscribe() returns FALSE once all
+ NMEA_SUBSCRIBERS slots are taken.
+
+ Callbacks run in decodeNmea() (or whatever calls nmeaDecodeContext()),
+ so keep them short and leave the record where it is. Code that wants a
+ queue of its own can copy the record into a MBX, or post a SEM and
+ read it from a TSK.
+
+ A sentence is only parsed if someone wants what its decoder reports,
+ either a subscriber or context->pollMask, the events polled for the
+ old way. pollMask is NMEA_EVENT_ALL after nmeaInitContext(); clear bits
+ from it to have sentences of those types skipped before any of their
+ fields are read (counted as unsubscribed in the stats).
+----------------------------------------------------------------------------*/
+#define NMEA_SUBSCRIBERS		8			// Callbacks a context can hold
+
+typedef void (*nmeaSubscriber)(Uint16 event, const void * record, void * arg);
+
+typedef struct {
+	Uint16 events;							// NMEA_EVENT_xxx bits wanted, 0 if slot free
+	nmeaSubscriber callback;
+	void * arg;								// Handed back to callback
+} nmeaSubscription;
+
+/*----------------------------------------------------------------------------
+ Accept list
+
+ By default the framer stores and checksums every sentence, and the
+ decoder throws away the ones nobody wants. A receiver sending fifteen
+ sentence types when three are used fills the buffer and posts the
+ decoder for nothing. nmeaAccept() adds an address (NMEA_ADDRESS()) or a
+ sentence from any talker (NMEA_FORMATTER()) to the context's accept
+ list. Once the list has anything on it, nmeaProcessContext() checks
+ each sentence's address as soon as its fifth char arrives and skips a
+ sentence that isn't on it to the next '$', storing nothing more of it
+ and never queueing it.
+
+ nmeaAccept() returns FALSE once the list's NMEA_ACCEPTSIZE entries are
+ used, nmeaAcceptAll() empties it again. Both hold off the SWIs while
+ they change it. Text framed with nmeaFrameText() isn't filtered.
+----------------------------------------------------------------------------*/
+#define NMEA_ACCEPTSIZE			8			// Addresses on an accept list
+
+/*----------------------------------------------------------------------------
+ Decoder context
+
+ Everything needed to decode one receiver: the framer state, the sentence
+ queue and its buffer, and the latest decoded data. Nothing is kept in
+ globals or function statics, so any number of receivers can be decoded
+ at once, each with its own context. Contexts share nothing but the
+ decoder lookup table, which is only read once the decoders are
+ registered.
+
+ The caller owns the memory. Call nmeaInitContext() once, then feed the
+ receiver's bytes to nmeaProcessContext() and run nmeaDecodeContext() when
+ it says sentences were queued. The two may run on different threads (see
+ the sentence queue above), but each must only run on one at a time.
+
+ On a host build the context is cache line aligned and padded, so contexts
+ on different threads never share a line. Allocate them with
+ posix_memalign() or aligned_alloc() (or as globals/arrays) to keep that.
+
+ processNmea() and decodeNmea() are the DSP/BIOS SWIs for the board's
+ receiver and use nmeaDefaultContext, which processNmea() initialises
+ the first time it runs.
+----------------------------------------------------------------------------*/
+typedef struct {
+	// Framer state, a message may lie across many UART buffers
+	CSLBool foundDollar;					// Holds if dollar start symbol was found
+	CSLBool foundStar;						// Holds if star end symbol was found
+	Uint16 checksum;						// NMEA Checksum (calculated)
+	Uint16 chkSum;							// Actual Checksum (from the message)
+	Uint16 chkSumChars;						// Counts how many bytes after '*' symbol
+	Uint16 sentenceStart;					// Holds where the current message starts in buffer
+	Uint16 length;							// How many chars of the current message we stored
+	Uint16 acceptCount;						// Addresses in accept, 0 takes every sentence
+	Uint32 accept[NMEA_ACCEPTSIZE];			// See nmeaAccept()
+
+	// Hand-over to the decoder
+	nmeaSentenceQueue queue;
+	nmeaChar buffer[NMEABUFFSIZE];			// Circular buffer to store messages
+	nmeaStats stats;						// What went through, see nmeaSnapshotStats()
+#ifdef NMEA_VERBOSE
+	nmeaTraceRing trace[2];					// NMEA_TRACE_FRAMER and _DECODER
+#endif
+
+	// Which talkers to decode (NMEA_TALKER_MASK() bits), and the
+	// constellation of the sentence being decoded
+	Uint16 talkerMask;
+	Uint16 constellation;
+	Uint16 sentences;						// Good sentences seen, the GSV timeout's clock
+
+	// Who wants what, see Subscriptions above. subscribed is every
+	// subscription's events ORed together
+	Uint16 pollMask;
+	Uint16 subscribed;
+	nmeaSubscription subscription[NMEA_SUBSCRIBERS];
+
+	// Decoded data, and a sequence number for each record (indexed as
+	// stats.decoded[]) that is odd while its decoder is writing it
+	volatile Uint16 sequence[NMEA_STATS_TYPES];
+	nmeaSkyTable sky;						// Satellites in view, all constellations (GPGSV)
+	nmeaGsvStage gsvStage;					// GSV cycle being collected for sky
+	nmeaGeographicPosition geographicPos;	// Structure holding our position & time (GPGLL)
+	nmeaFixData fixData;					// Fix quality, altitude etc. (GPGGA)
+	nmeaNavigationData navigationData;		// Date, time, position, speed and course (GPRMC)
+	nmeaActiveSatellites activeSats;		// Satellites used and DOPs (GPGSA)
+	nmeaVelocityData velocity;				// Course and speed (GPVTG)
+	nmeaDateTime dateTime;					// Date, time and time zone (GPZDA)
+	nmeaEpochFix epoch;						// The last whole epoch
+	nmeaEpochStage epochStage;				// The epoch being put together for it
+} nmeaContext;
+
+// What nmeaDecodeContext() found, one bit per kind of update
+#define NMEA_EVENT_POSITION		0x0001		// Position and time (GLL), check its status
+#define NMEA_EVENT_SATELLITES	0x0002		// Satellites in view (GSV)
+#define NMEA_EVENT_FIX			0x0004		// Fix data (GGA), check its fixQuality
+#define NMEA_EVENT_NAVIGATION	0x0008		// Navigation data (RMC), check its status
+#define NMEA_EVENT_ACTIVE		0x0010		// Satellites used and DOPs (GSA)
+#define NMEA_EVENT_VELOCITY		0x0020		// Course and speed (VTG)
+#define NMEA_EVENT_TIME			0x0040		// Date and time (ZDA)
+#define NMEA_EVENT_EPOCH		0x0080		// A whole epoch (all of the above but GSV)
+#define NMEA_EVENT_ALL			0xFFFF
+
+// What the epoch assembler is made from, and which of those come once an epoch
+#define NMEA_EPOCH_SOURCES		(NMEA_EVENT_POSITION | NMEA_EVENT_FIX | NMEA_EVENT_NAVIGATION | \
+								 NMEA_EVENT_ACTIVE | NMEA_EVENT_VELOCITY | NMEA_EVENT_TIME)
+#define NMEA_EPOCH_ONCE			(NMEA_EPOCH_SOURCES & ~NMEA_EVENT_ACTIVE)
+
+extern nmeaContext nmeaDefaultContext;
+
+void nmeaInitContext(nmeaContext * context);
+Uint16 nmeaProcessContext(nmeaContext * context, const nmeaChar * data, Uint16 count);
+Uint16 nmeaDecodeContext(nmeaContext * context);
+void nmeaSnapshotStats(const nmeaContext * context, nmeaStats * stats);
+#ifdef NMEA_VERBOSE
+Uint16 nmeaDrainTrace(nmeaContext * context);
+#endif
+
+CSLBool nmeaSubscribe(nmeaContext * context, Uint16 events, nmeaSubscriber callback, void * arg);
+void nmeaUnsubscribe(nmeaContext * context, nmeaSubscriber callback, void * arg);
+const void * nmeaEventRecord(const nmeaContext * context, Uint16 event);
+
+/*----------------------------------------------------------------------------
+ Snapshots
+
+ The decoders write their records a field at a time, so a task reading
+ context->geographicPos (or the sky table) straight may get half of one
+ sentence and half of the next. nmeaReadRecord() copies the record for
+ one NMEA_EVENT_xxx bit into copy (which must be the record's type)
+ without locking anything or holding up the decoder.
+
+ It works as a seqlock. nmeaDecodeSentence() moves the sequence number
+ of each record a decoder may write on before running it, so it is odd
+ while the record may be being written. Afterwards it moves it on again
+ for each event the decoder returned, and back to where it was for the
+ rest, as a decoder only writes its record when it reports it. The
+ reader notes the number, copies the record and checks the number again,
+ copying again if the decoder got in between. When nothing is being
+ written that is two loads on top of the copy itself.
+
+ Returns how many times the record has been written (mod 0x8000), which
+ is how many times its event has been reported, 0 if never (or event
+ isn't one bit), so a reader can tell whether it has changed since the
+ last copy. A sentence dropped as malformed, or a GSV that doesn't finish
+ a cycle, leaves it as it was. Call it from a TSK or the host threads, not
+ from a HWI or a SWI that can pre-empt decodeNmea(), which would wait for
+ ever on a record the decoder was part way through. Subscriber callbacks
+ run after the write is done and can use their record as it is.
+----------------------------------------------------------------------------*/
+Uint16 nmeaReadRecord(const nmeaContext * context, Uint16 event, void * copy);
+
+// See Accept list above
+CSLBool nmeaAccept(nmeaContext * context, Uint32 address);
+void nmeaAcceptAll(nmeaContext * context);
+
+// For text that is already all in memory (e.g. a capture file) rather than
+// arriving from a UART. nmeaFrameText() frames it in place, without the
+// queue, and nmeaDecodeSentence() runs the decoder for one view
+Uint16 nmeaDecodeSentence(nmeaContext * context, const nmeaSentenceView * sentence);
+CSLBool nmeaFrameText(const nmeaChar * data, Uint32 count, Uint32 * position, nmeaSentenceView * view);
+
+/*----------------------------------------------------------------------------
+ Sentence decoders
+
+ A decoder is handed the context and the view of a sentence with a good
+ checksum whose address it was registered against with
+ nmeaRegisterDecoder(). It returns the NMEA_EVENT_xxx bits for what it
+ updated, tagging what it wrote with context->constellation, and must
+ leave the record for any event it doesn't return untouched (see
+ Snapshots). Register it with the bits it can return, so its sentences
+ can be skipped when nobody wants them (see Subscriptions).
+
+ Register against NMEA_FORMATTER() to get a sentence from every talker,
+ or against the full address for one talker only. The full address is
+ looked up first, so a talker can have a decoder of its own.
+
+ Lookups hash the packed address into a small open addressed table and
+ compare the full address, so finding the decoder takes the same time
+ however many sentence types are registered.
+
+ The decoders in nmea_dec.c are registered by the first nmeaInitContext()
+ or nmeaDecodeContext() call (once only, through pthread_once() on a host
+ build). Register your own after that, and before anything decodes on
+ another thread, as the table itself is not locked.
+----------------------------------------------------------------------------*/
+typedef Uint16 (*nmeaDecoder)(nmeaContext * context, const nmeaSentenceView * sentence);
+
+CSLBool nmeaRegisterDecoder(Uint32 address, nmeaDecoder decoder, Uint16 events);
+nmeaDecoder nmeaFindDecoder(Uint32 address);
+Uint32 nmeaSentenceAddress(const nmeaSentenceView * sentence);
+Uint16 nmeaAddressConstellation(Uint32 address);
+
+/*----------------------------------------------------------------------------
+ Sky table
+
+ nmeaSkyFind() returns the slot of a satellite, or NMEA_SKY_NONE.
+ nmeaSkyAdd() does the same but gives it a slot if it hasn't got one
+ (fill in its columns straight away), returning NMEA_SKY_NONE only if
+ the table is full. nmeaSkyClear() takes
+ out every satellite of one constellation.
+----------------------------------------------------------------------------*/
+void nmeaSkyInit(nmeaSkyTable * sky);
+Uint16 nmeaSkyFind(const nmeaSkyTable * sky, Uint16 constellation, Uint16 prn);
+Uint16 nmeaSkyAdd(nmeaSkyTable * sky, Uint16 constellation, Uint16 prn);
+void nmeaSkyClear(nmeaSkyTable * sky, Uint16 constellation);
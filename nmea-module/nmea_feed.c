@@ -0,0 +1,136 @@
+/*
+ * NMEA Decoder - Feeding a File or Pipe through the SWIs (host build only)
+ *
+ * Plays uartHwi on a PC. The receiver's output is read from a file, a
+ * pipe or a serial device straight into the buffer nmeaUartFillBuffer()
+ * gives out, handed to processNmea() with nmeaUartHandOver(), and
+ * decodeNmea() is run whenever processNmea() posts it. Everything after
+ * the read is the code that runs on the board.
+ *
+ * e.g. gcc -O2 -DNMEA_HOST -DNMEA_PACKED_RING -DNMEA_FEED_MAIN
+ *          nmea_feed.c nmea_dec.c -o nmeafeed
+ *      cat capture.nmea | ./nmeafeed
+ *      ./nmeafeed /dev/ttyUSB0
+ */
+
+/*
+ *  Include Files
+ */
+#include "nmea_host.h"
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "ascii_16.h"
+#include "nmea_dec.h"
+
+/*----------------------------------------------------------------------------
+ Feeds everything that can be read from fd through the board's SWIs, a
+ read (at most UARTBUFFSIZE chars) per buffer as a UART with an idle
+ timeout would hand them over. Returns the number of chars fed at end of
+ file, or -1 with errno set if a read fails.
+----------------------------------------------------------------------------*/
+long nmeaHostFeed(int fd)
+{
+	nmeaChar * buffer;
+	long total;
+	ssize_t got;
+	Uns posts;
+#ifndef NMEA_PACKED_RING
+	Uint8 bytes[UARTBUFFSIZE];				// A word ring needs each byte widened
+	ssize_t i;
+#endif
+
+	total = 0;
+
+	for (;;)
+	{
+		// processNmea() runs straight after each hand-over, so there is
+		// always a buffer free
+		buffer = nmeaUartFillBuffer(&nmeaUartInput);
+
+#ifdef NMEA_PACKED_RING
+		got = read(fd, buffer, UARTBUFFSIZE);
+#else
+		got = read(fd, bytes, UARTBUFFSIZE);
+#endif
+		if (got < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (got <= 0)
+		{
+			break;
+		}
+
+#ifndef NMEA_PACKED_RING
+		for (i = 0; i < got; i++)
+		{
+			buffer[i] = bytes[i];
+		}
+#endif
+
+		nmeaUartHandOver(&nmeaUartInput, (Uint16)got);
+		posts = nmeaHostSwiPosts;
+		processNmea();
+
+		if (nmeaHostSwiPosts != posts)
+		{
+			decodeNmea();
+		}
+
+		total += got;
+	}
+
+	return (got < 0) ? -1 : total;
+}
+
+#ifdef NMEA_FEED_MAIN
+/*----------------------------------------------------------------------------
+ Command line front end
+
+ Feeds a file (or stdin) and prints one line per epoch:
+	hh:mm:ss,status,latitudeE7,longitudeE7,altitude,used,hdop,speed,course
+ then what went through on stderr.
+----------------------------------------------------------------------------*/
+void nmeaFeedPrint(Uint16 event, const void * record, void * arg)
+{
+	const nmeaEpochFix * fix = record;
+	FILE * out = arg;
+
+	fprintf(out, "%02d:%02d:%02d,%c,%ld,%ld,%ld,%d,%d,%d,%d\n",
+			fix->utcGpsTime.utcHours, fix->utcGpsTime.utcMinutes, fix->utcGpsTime.utcSeconds,
+			fix->status ? fix->status : '-', (long)fix->latitudeE7, (long)fix->longitudeE7,
+			(long)fix->altitude, fix->usedCount, fix->hdop, fix->speed, fix->course);
+}
+
+int main(int argc, char * argv[])
+{
+	nmeaStats stats;
+	long fed;
+	int fd;
+
+	fd = (argc > 1) ? open(argv[1], O_RDONLY) : 0;
+	if (fd < 0)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+
+	// Let processNmea() set up the board's context first, as on the board
+	processNmea();
+	nmeaSubscribe(&nmeaDefaultContext, NMEA_EVENT_EPOCH, nmeaFeedPrint, stdout);
+
+	fed = nmeaHostFeed(fd);
+	if (fed < 0)
+	{
+		perror("read");
+		return 1;
+	}
+
+	nmeaSnapshotStats(&nmeaDefaultContext, &stats);
+	fprintf(stderr, "%ld chars, %lu epochs, %lu checksum errors, %lu overruns, %lu buffers dropped\n",
+			fed, (unsigned long)stats.decoded[7], (unsigned long)stats.checksumErrors,
+			(unsigned long)stats.overruns, (unsigned long)nmeaUartInput.dropped);
+	return 0;
+}
+#endif
@@ -0,0 +1,86 @@
+/*
+ * NMEA Decoder - Host (Linux) Build Support
+ *
+ * Compiling nmea_dec.c with NMEA_HOST defined pulls this file in instead
+ * of the DSP/BIOS, CSL and board headers. It supplies the CSL types and
+ * stands in for the handful of BIOS calls the decoder makes, so the same
+ * source can be built and exercised with gcc on a PC.
+ *
+ * e.g. gcc -DNMEA_HOST -DNMEA_PACKED_RING -O2 -c nmea_dec.c
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+/*----------------------------------------------------------------------------
+ CSL types
+----------------------------------------------------------------------------*/
+typedef uint8_t		Uint8;
+typedef int8_t		Int8;
+typedef uint16_t	Uint16;
+typedef int16_t		Int16;
+typedef uint32_t	Uint32;
+typedef int32_t		Int32;
+typedef uint64_t	Uint64;
+typedef unsigned int	Uns;
+typedef int			CSLBool;
+
+// 64 bit little endian hosts parse long runs of digits a word at a time,
+// see nmeaParseDigits()
+#if UINTPTR_MAX > 0xFFFFFFFFu && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define NMEA_SWAR
+#endif
+
+// The little per field helpers in nmea_dec.c are worth inlining here
+#define NMEA_INLINE		static inline
+
+#ifndef TRUE
+#define TRUE		1
+#define FALSE		0
+#endif
+
+/*----------------------------------------------------------------------------
+ DSP/BIOS stand-ins
+
+ The BIOS objects (logNmea, decodeNmeaSwi etc.) are only ever passed by
+ address, so the macros drop them. Host code plays uartHwi by handing
+ buffers over through nmeaUartInput (see nmeaHostFeed()) before calling
+ processNmea(), and the posts are counted so it can tell when
+ decodeNmea() is due.
+
+ CLK_getltime() is the CPU's time stamp counter on x86, clock() elsewhere.
+
+ SWI_disable() and SWI_enable() do nothing, host code that runs the two
+ SWIs on different threads has to allow for that (see nmeaStats).
+
+ LOG_printf() is silent unless NMEA_HOST_LOG is defined. The decoder
+ only logs from nmeaDrainTrace() if built with NMEA_VERBOSE, and dumps
+ a sentence's data only if its OUTPUT_xxx is defined in nmea_dec.c.
+----------------------------------------------------------------------------*/
+extern Uns nmeaHostSwiPosts;				// How many times SWI_post() was called
+extern Uns nmeaHostSemPosts;				// How many times SEM_postBinary() was called
+
+void processNmea(void);						// The SWIs, called directly by host code
+void decodeNmea(void);
+
+// Reads a file or pipe into the SWIs as uartHwi would, see nmea_feed.c
+long nmeaHostFeed(int fd);
+
+#define SWI_post(swi)			(nmeaHostSwiPosts++)
+#define SEM_postBinary(sem)		(nmeaHostSemPosts++)
+#define SWI_disable()
+#define SWI_enable()
+#if defined(__x86_64__) || defined(__i386__)
+#define CLK_getltime()			((Uint32)__builtin_ia32_rdtsc())
+#else
+#define CLK_getltime()			((Uint32)clock())
+#endif
+
+#ifdef NMEA_HOST_LOG
+#define LOG_printf(log, ...)	(printf(__VA_ARGS__), printf("\n"))
+#else
+#define LOG_printf(log, ...)	((void)(0 && printf(__VA_ARGS__)))
+#endif
@@ -0,0 +1,285 @@
+/*
+ * NMEA Decoder - Sentence Queue Stress Test (host build only)
+ *
+ * Runs processNmea() and a consumer of the sentence queue on two threads,
+ * as processNmea() and decodeNmea() share it on the board, and pushes
+ * millions of GGA sentences through it. Each sentence carries its
+ * sequence number (as the altitude in cm) and values worked out from it,
+ * and is cut into UART buffers of random length so sentences straddle
+ * buffers at every point.
+ *
+ * The consumer side checks that every sentence arrives in order, with a
+ * good checksum, and reads back exactly as it was sent. At the end every
+ * sentence sent must either have come out of the queue or be counted in
+ * its overruns.
+ *
+ * By default the framer waits for room in the queue, as the UART would
+ * if decodeNmea() kept up, and there must be no overruns at all. With
+ * "flat" it runs flat out and drops whatever doesn't fit. Then little may
+ * come out of the queue if the consumer thread doesn't get a core of its
+ * own, so the run warns when under NMEA_STRESS_MINFLAT percent of them did.
+ *
+ * e.g. gcc -O2 -DNMEA_HOST -DNMEA_PACKED_RING nmea_stress.c nmea_dec.c
+ *          -lpthread -o nmeastress
+ *      ./nmeastress [sentences] [flat]
+ */
+
+/*
+ *  Include Files
+ */
+#include "nmea_host.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "ascii_16.h"
+#include "nmea_dec.h"
+
+/*
+ *  Declarations
+ */
+#define NMEA_STRESS_SENTENCES	5000000UL	// Sentences sent by default
+#define NMEA_STRESS_MAX			2000000000UL	// Most the altitude can carry
+#define NMEA_STRESS_MINFLAT		50			// % that should get through a flat run
+#define NMEA_STRESS_FIELDS		15			// Fields in each sentence
+
+typedef struct {
+	Uint32 sentences;						// How many the framer sends
+	CSLBool paced;							// Framer waits for room in the queue
+	CSLBool done;							// Framer has sent them all
+	Uint32 received;						// Sentences the consumer got
+	Uint32 missing;							// Gaps in the sequence it saw
+	Uint32 outOfOrder;						// Sentences at or before the last one
+	Uint32 wrong;							// Sentences not reading as sent
+	Uint32 last;							// Sequence number of the last one, +1
+} nmeaStressRun;
+
+void processNmea(void);						// From nmea_dec.c
+Uint16 nmeaViewChar(const nmeaSentenceView * view, Uint16 offset);
+
+/*
+ *  Prototypes
+ */
+Uint16 nmeaStressSentence(Uint32 sequence, char * text);
+											// Writes sentence number sequence
+void nmeaStressCheck(nmeaStressRun * run, const nmeaSentenceView * sentence);
+											// Checks one sentence from the queue
+void * nmeaStressFramer(void * arg);		// The processNmea() side
+void * nmeaStressConsumer(void * arg);		// The decodeNmea() side
+
+/*----------------------------------------------------------------------------
+ Writes sentence number sequence (with its CR LF) into text and returns
+ its length
+----------------------------------------------------------------------------*/
+Uint16 nmeaStressSentence(Uint32 sequence, char * text)
+{
+	Uint16 length;
+	Uint16 checksum;
+	Uint16 i;
+
+	length = (Uint16)sprintf(text, "$GPGGA,%02lu%02lu%02lu.00,%02lu%02lu.%04lu,N,%03lu%02lu.%04lu,W,1,%02lu,0.9,%lu.%02lu,M,46.9,M,,",
+			 (unsigned long)((sequence / 3600) % 24), (unsigned long)((sequence / 60) % 60), (unsigned long)(sequence % 60),
+			 (unsigned long)(sequence % 90), (unsigned long)((sequence / 7) % 60), (unsigned long)(sequence % 10000),
+			 (unsigned long)(sequence % 180), (unsigned long)((sequence / 11) % 60), (unsigned long)((sequence / 3) % 10000),
+			 (unsigned long)(sequence % 13), (unsigned long)(sequence / 100), (unsigned long)(sequence % 100));
+
+	checksum = 0;
+	for (i = 1; i < length; i++)
+	{
+		checksum ^= (Uint8)text[i];
+	}
+
+	return length + (Uint16)sprintf(text + length, "*%02X\r\n", checksum);
+}
+
+/*----------------------------------------------------------------------------
+ Reads the sequence number back out of the altitude, then checks the
+ whole sentence against what that number was sent as
+----------------------------------------------------------------------------*/
+void nmeaStressCheck(nmeaStressRun * run, const nmeaSentenceView * sentence)
+{
+	char text[NMEA_MAXLENGTH + 8];
+	Uint32 sequence;
+	Uint16 offset;
+	Uint16 length;
+	Uint16 ascii;
+	Uint16 i;
+
+	run->received++;
+
+	// Altitude is field 9, whole metres then two places
+	sequence = 0;
+	for (offset = sentence->field[9]; (ascii = nmeaViewChar(sentence, offset)) != A_COMMA; offset++)
+	{
+		if (ascii != A_FULLSTOP)
+		{
+			sequence = sequence * 10 + (ascii - '0');
+		}
+	}
+
+	if (sequence < run->last)
+	{
+		run->outOfOrder++;
+		return;
+	}
+
+	run->missing += sequence - run->last;
+	run->last = sequence + 1;
+
+	// The view holds what is between the '$' and the '*'
+	length = nmeaStressSentence(sequence, text) - 5;
+	if (sentence->status != NMEA_SENTENCE_GOOD || sentence->length != length - 1 ||
+		sentence->fieldCount != NMEA_STRESS_FIELDS)
+	{
+		run->wrong++;
+		return;
+	}
+
+	for (i = 1; i < length; i++)
+	{
+		if (nmeaViewChar(sentence, i - 1) != (Uint16)text[i])
+		{
+			run->wrong++;
+			return;
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ Sends the sentences a random sized UART buffer at a time
+----------------------------------------------------------------------------*/
+void * nmeaStressFramer(void * arg)
+{
+	nmeaStressRun * run = arg;
+	nmeaSentenceQueue * queue = &nmeaDefaultContext.queue;
+	char text[NMEA_MAXLENGTH + 8];
+	Uint32 sequence;
+	Uint32 seed;
+	Uint16 length;
+	Uint16 used;
+	Uint16 held;
+	Uint16 i;
+	nmeaChar * buffer;
+
+	seed = 12345;
+	held = 0;
+	used = 0;
+	length = 0;
+
+	for (sequence = 0; sequence < run->sentences || used < length; )
+	{
+		// Fill a buffer of 1 to UARTBUFFSIZE chars across sentences, the
+		// one uartHwi would fill next
+		buffer = nmeaUartFillBuffer(&nmeaUartInput);
+		seed = seed * 1103515245UL + 12345;
+		held = (Uint16)(1 + (seed >> 16) % UARTBUFFSIZE);
+		for (i = 0; i < held; i++)
+		{
+			if (used == length)
+			{
+				if (sequence == run->sentences)
+				{
+					break;
+				}
+				length = nmeaStressSentence(sequence++, text);
+				used = 0;
+			}
+			buffer[i] = (nmeaChar)text[used++];
+		}
+
+		// When paced, wait until the buffer's chars and the sentence they
+		// may finish are sure to fit
+		while (run->paced &&
+			   ((Uint16)(queue->head - queue->tail) >= NMEASENTBUFFSIZE - 1 ||
+				(Uint16)(queue->dataHead - queue->dataTail) + i >= NMEABUFFSIZE))
+		{
+			sched_yield();
+		}
+
+		nmeaUartHandOver(&nmeaUartInput, i);
+		processNmea();
+	}
+
+	// Everything it queued is published before this is seen
+	__atomic_store_n(&run->done, TRUE, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ Takes sentences off the queue until the framer is done and it is empty
+----------------------------------------------------------------------------*/
+void * nmeaStressConsumer(void * arg)
+{
+	nmeaStressRun * run = arg;
+	nmeaSentenceQueue * queue = &nmeaDefaultContext.queue;
+	nmeaSentenceView * sentence;
+	CSLBool done;
+
+	do
+	{
+		done = __atomic_load_n(&run->done, __ATOMIC_ACQUIRE);
+		if ((sentence = nmeaQueuePeek(queue)) == NULL)
+		{
+			sched_yield();
+			continue;
+		}
+
+		nmeaStressCheck(run, sentence);
+		nmeaQueueRelease(queue);
+		done = FALSE;
+	} while (!done);
+
+	return NULL;
+}
+
+int main(int argc, char * argv[])
+{
+	nmeaStressRun run;
+	pthread_t framer;
+	pthread_t consumer;
+	Uint32 overruns;
+	int failed;
+
+	memset(&run, 0, sizeof(run));
+	run.sentences = (argc > 1) ? (Uint32)strtoul(argv[1], NULL, 0) : NMEA_STRESS_SENTENCES;
+	run.paced = !(argc > 2 && strcmp(argv[2], "flat") == 0);
+	if (run.sentences == 0 || run.sentences > NMEA_STRESS_MAX || (argc > 2 && run.paced))
+	{
+		fprintf(stderr, "usage: %s [sentences] [flat]\n", argv[0]);
+		return 2;
+	}
+
+	if (pthread_create(&consumer, NULL, nmeaStressConsumer, &run) != 0 ||
+		pthread_create(&framer, NULL, nmeaStressFramer, &run) != 0)
+	{
+		perror("pthread_create");
+		return 1;
+	}
+	pthread_join(framer, NULL);
+	pthread_join(consumer, NULL);
+
+	overruns = nmeaDefaultContext.queue.overruns;
+
+	// Sentences lost off the end show up as missing too
+	run.missing += run.sentences - run.last;
+
+	printf("sent %lu received %lu overruns %lu missing %lu out of order %lu wrong %lu\n",
+		   (unsigned long)run.sentences, (unsigned long)run.received, (unsigned long)overruns,
+		   (unsigned long)run.missing, (unsigned long)run.outOfOrder, (unsigned long)run.wrong);
+
+	failed = run.received + overruns != run.sentences ||
+			 run.missing != overruns ||
+			 run.outOfOrder != 0 || run.wrong != 0 ||
+			 (run.paced && overruns != 0);
+
+	// A flat run that dropped nearly everything says little about the
+	// hand-off itself
+	if (!run.paced && run.received < run.sentences / 100 * NMEA_STRESS_MINFLAT)
+	{
+		printf("warning: only %lu%% came out of the queue, give the threads a core each\n",
+			   (unsigned long)(run.received / (run.sentences / 100 + 1)));
+	}
+
+	printf("%s\n", failed ? "FAILED" : "passed");
+	return failed ? 1 : 0;
+}